@@ -1,12 +1,10 @@
 #include "global_input.h"
 
+#include <godot_cpp/classes/engine.hpp>
 #include <thread>
 
 using namespace godot;
 
-bool GlobalInput::hook_started = false;
-bool GlobalInput::use_physics_frames = false;
-
 GlobalInput::GlobalInput() {}
 
 GlobalInput::~GlobalInput() {}
@@ -16,6 +14,8 @@ void GlobalInput::_bind_methods() {
     ClassDB::bind_method(D_METHOD("is_key_pressed", "key"), &GlobalInput::is_key_pressed);
     ClassDB::bind_method(D_METHOD("is_key_just_pressed", "key"), &GlobalInput::is_key_just_pressed);
     ClassDB::bind_method(D_METHOD("is_key_just_released", "key"), &GlobalInput::is_key_just_released);
+    ClassDB::bind_method(D_METHOD("is_physical_key_pressed", "key"), &GlobalInput::is_physical_key_pressed);
+    ClassDB::bind_method(D_METHOD("is_scancode_pressed", "scancode"), &GlobalInput::is_scancode_pressed);
     ClassDB::bind_method(D_METHOD("is_mouse_pressed", "button"), &GlobalInput::is_mouse_pressed);
     ClassDB::bind_method(D_METHOD("is_mouse_just_pressed", "button"), &GlobalInput::is_mouse_just_pressed);
     ClassDB::bind_method(D_METHOD("is_mouse_just_released", "button"), &GlobalInput::is_mouse_just_released);
@@ -24,29 +24,195 @@ void GlobalInput::_bind_methods() {
     ClassDB::bind_method(D_METHOD("is_action_just_pressed", "action"), &GlobalInput::is_action_just_pressed);
     ClassDB::bind_method(D_METHOD("is_action_just_released", "action"), &GlobalInput::is_action_just_released);
 
+    ClassDB::bind_method(D_METHOD("is_key_echo", "key"), &GlobalInput::is_key_echo);
+    ClassDB::bind_method(D_METHOD("get_key_repeat_count", "key"), &GlobalInput::get_key_repeat_count);
+    ClassDB::bind_method(D_METHOD("is_action_repeating", "action"), &GlobalInput::is_action_repeating);
+    ClassDB::bind_method(D_METHOD("set_action_repeat", "action", "delay_ms", "rate"), &GlobalInput::set_action_repeat);
+    ClassDB::bind_method(D_METHOD("clear_action_repeat", "action"), &GlobalInput::clear_action_repeat);
+    ClassDB::bind_method(D_METHOD("set_action_repeat_delay_ms", "msec"), &GlobalInput::set_action_repeat_delay_ms);
+    ClassDB::bind_method(D_METHOD("get_action_repeat_delay_ms"), &GlobalInput::get_action_repeat_delay_ms);
+    ClassDB::bind_method(D_METHOD("set_action_repeat_rate", "rate"), &GlobalInput::set_action_repeat_rate);
+    ClassDB::bind_method(D_METHOD("get_action_repeat_rate"), &GlobalInput::get_action_repeat_rate);
+
+    ClassDB::bind_method(D_METHOD("is_key_pressed_within", "key", "msec"), &GlobalInput::is_key_pressed_within);
+    ClassDB::bind_method(D_METHOD("is_mouse_pressed_within", "button", "msec"), &GlobalInput::is_mouse_pressed_within);
+    ClassDB::bind_method(D_METHOD("is_action_buffered", "action", "msec"), &GlobalInput::is_action_buffered, DEFVAL(-1));
+    ClassDB::bind_method(D_METHOD("set_action_buffer", "action", "msec"), &GlobalInput::set_action_buffer);
+    ClassDB::bind_method(D_METHOD("get_action_buffer", "action"), &GlobalInput::get_action_buffer);
+    ClassDB::bind_method(D_METHOD("set_action_buffer_ms", "msec"), &GlobalInput::set_action_buffer_ms);
+    ClassDB::bind_method(D_METHOD("get_action_buffer_ms"), &GlobalInput::get_action_buffer_ms);
+
+    ClassDB::bind_method(D_METHOD("get_mouse_delta"), &GlobalInput::get_mouse_delta);
+    ClassDB::bind_method(D_METHOD("get_mouse_path"), &GlobalInput::get_mouse_path);
+    ClassDB::bind_method(D_METHOD("set_mouse_motion_mode", "mode"), &GlobalInput::set_mouse_motion_mode);
+    ClassDB::bind_method(D_METHOD("get_mouse_motion_mode"), &GlobalInput::get_mouse_motion_mode);
+    ClassDB::bind_method(D_METHOD("get_mouse_velocity"), &GlobalInput::get_mouse_velocity);
+    ClassDB::bind_method(D_METHOD("get_mouse_acceleration"), &GlobalInput::get_mouse_acceleration);
+
+    ClassDB::bind_method(D_METHOD("get_pen_pressure"), &GlobalInput::get_pen_pressure);
+    ClassDB::bind_method(D_METHOD("get_pen_tilt"), &GlobalInput::get_pen_tilt);
+
+    ClassDB::bind_method(D_METHOD("is_joy_button_pressed", "device", "button"), &GlobalInput::is_joy_button_pressed);
+    ClassDB::bind_method(D_METHOD("get_joy_axis", "device", "axis"), &GlobalInput::get_joy_axis);
+    ClassDB::bind_method(D_METHOD("set_joy_deadzone", "deadzone"), &GlobalInput::set_joy_deadzone);
+    ClassDB::bind_method(D_METHOD("get_joy_deadzone"), &GlobalInput::get_joy_deadzone);
+
     ClassDB::bind_method(D_METHOD("get_keys_pressed_detailed"), &GlobalInput::get_keys_pressed_detailed);
     ClassDB::bind_method(D_METHOD("get_keys_just_pressed_detailed"), &GlobalInput::get_keys_just_pressed_detailed);
     ClassDB::bind_method(D_METHOD("get_keys_just_released_detailed"), &GlobalInput::get_keys_just_released_detailed);
 
+    ClassDB::bind_method(D_METHOD("get_frame_snapshot"), &GlobalInput::get_frame_snapshot);
+    ClassDB::bind_method(D_METHOD("set_snapshot_actions", "actions"), &GlobalInput::set_snapshot_actions);
+    ClassDB::bind_method(D_METHOD("get_snapshot_actions"), &GlobalInput::get_snapshot_actions);
+    ClassDB::bind_method(D_METHOD("set_thread_safe_reads", "enabled"), &GlobalInput::set_thread_safe_reads);
+    ClassDB::bind_method(D_METHOD("set_history_size", "ticks"), &GlobalInput::set_history_size);
+    ClassDB::bind_method(D_METHOD("get_history_size"), &GlobalInput::get_history_size);
+    ClassDB::bind_method(D_METHOD("get_key_state_at", "tick", "key"), &GlobalInput::get_key_state_at);
+    ClassDB::bind_method(D_METHOD("get_snapshot_at", "tick"), &GlobalInput::get_snapshot_at);
+    ClassDB::bind_method(D_METHOD("get_history_oldest_tick"), &GlobalInput::get_history_oldest_tick);
+    ClassDB::bind_method(D_METHOD("get_history_newest_tick"), &GlobalInput::get_history_newest_tick);
+    ClassDB::bind_method(D_METHOD("get_thread_safe_reads"), &GlobalInput::get_thread_safe_reads);
+
     ClassDB::bind_method(D_METHOD("is_shift_pressed"), &GlobalInput::is_shift_pressed);
     ClassDB::bind_method(D_METHOD("is_ctrl_pressed"), &GlobalInput::is_ctrl_pressed);
     ClassDB::bind_method(D_METHOD("is_alt_pressed"), &GlobalInput::is_alt_pressed);
     ClassDB::bind_method(D_METHOD("is_meta_pressed"), &GlobalInput::is_meta_pressed);
+    ClassDB::bind_method(D_METHOD("get_modifier_mask"), &GlobalInput::get_modifier_mask);
+    ClassDB::bind_method(D_METHOD("is_modifier_pressed", "modifiers"), &GlobalInput::is_modifier_pressed);
 
     ClassDB::bind_method(D_METHOD("start_hook"), &GlobalInput::start_hook);
     ClassDB::bind_method(D_METHOD("stop_hook"), &GlobalInput::stop_hook);
     
     ClassDB::bind_method(D_METHOD("set_backend", "backend_name"), &GlobalInput::set_backend);
     ClassDB::bind_method(D_METHOD("get_backend"), &GlobalInput::get_backend);
+    ClassDB::bind_method(D_METHOD("get_active_backend"), &GlobalInput::get_active_backend);
 
     ClassDB::bind_method(D_METHOD("set_use_physics_frames", "enabled"), &GlobalInput::set_use_physics_frames);
     ClassDB::bind_method(D_METHOD("get_use_physics_frames"), &GlobalInput::get_use_physics_frames);
 
-    ADD_PROPERTY(PropertyInfo(Variant::STRING, "backend", PROPERTY_HINT_ENUM, "windows,x11, dummy"),
+    ClassDB::bind_method(D_METHOD("get_devices"), &GlobalInput::get_devices);
+    ClassDB::bind_method(D_METHOD("add_virtual_device", "path", "role", "name"), &GlobalInput::add_virtual_device, DEFVAL(""));
+
+    ClassDB::bind_method(D_METHOD("set_async_start", "enabled"), &GlobalInput::set_async_start);
+    ClassDB::bind_method(D_METHOD("get_async_start"), &GlobalInput::get_async_start);
+    ClassDB::bind_method(D_METHOD("is_hook_ready"), &GlobalInput::is_hook_ready);
+
+    ClassDB::bind_method(D_METHOD("set_debounce_ms", "msec"), &GlobalInput::set_debounce_ms);
+    ClassDB::bind_method(D_METHOD("get_debounce_ms"), &GlobalInput::get_debounce_ms);
+    ClassDB::bind_method(D_METHOD("set_debounce_mode", "mode"), &GlobalInput::set_debounce_mode);
+    ClassDB::bind_method(D_METHOD("get_debounce_mode"), &GlobalInput::get_debounce_mode);
+    ClassDB::bind_method(D_METHOD("set_key_debounce", "key", "msec"), &GlobalInput::set_key_debounce);
+    ClassDB::bind_method(D_METHOD("get_debounce_suppressed"), &GlobalInput::get_debounce_suppressed);
+
+    ClassDB::bind_method(D_METHOD("set_tracked_keys", "keys"), &GlobalInput::set_tracked_keys);
+    ClassDB::bind_method(D_METHOD("get_tracked_keys"), &GlobalInput::get_tracked_keys);
+    ClassDB::bind_method(D_METHOD("track_action", "action"), &GlobalInput::track_action);
+    ClassDB::bind_method(D_METHOD("clear_tracked_keys"), &GlobalInput::clear_tracked_keys);
+
+    ClassDB::bind_method(D_METHOD("set_power_saving", "enabled"), &GlobalInput::set_power_saving);
+    ClassDB::bind_method(D_METHOD("get_power_saving"), &GlobalInput::get_power_saving);
+    ClassDB::bind_method(D_METHOD("get_hook_wakeups_per_second"), &GlobalInput::get_hook_wakeups_per_second);
+
+    ClassDB::bind_method(D_METHOD("set_hook_thread_nice", "nice"), &GlobalInput::set_hook_thread_nice);
+    ClassDB::bind_method(D_METHOD("get_hook_thread_nice"), &GlobalInput::get_hook_thread_nice);
+    ClassDB::bind_method(D_METHOD("set_hook_thread_fifo_priority", "priority"), &GlobalInput::set_hook_thread_fifo_priority);
+    ClassDB::bind_method(D_METHOD("get_hook_thread_fifo_priority"), &GlobalInput::get_hook_thread_fifo_priority);
+    ClassDB::bind_method(D_METHOD("set_hook_thread_affinity", "mask"), &GlobalInput::set_hook_thread_affinity);
+    ClassDB::bind_method(D_METHOD("get_hook_thread_affinity"), &GlobalInput::get_hook_thread_affinity);
+    ClassDB::bind_method(D_METHOD("set_hook_thread_name", "name"), &GlobalInput::set_hook_thread_name);
+    ClassDB::bind_method(D_METHOD("get_hook_thread_name"), &GlobalInput::get_hook_thread_name);
+    ClassDB::bind_method(D_METHOD("get_hook_thread_error"), &GlobalInput::get_hook_thread_error);
+
+    ClassDB::bind_method(D_METHOD("set_shared_memory_name", "name"), &GlobalInput::set_shared_memory_name);
+    ClassDB::bind_method(D_METHOD("get_shared_memory_name"), &GlobalInput::get_shared_memory_name);
+
+    ClassDB::bind_method(D_METHOD("set_event_stream_path", "path"), &GlobalInput::set_event_stream_path);
+    ClassDB::bind_method(D_METHOD("get_event_stream_path"), &GlobalInput::get_event_stream_path);
+    ClassDB::bind_method(D_METHOD("get_event_stream_dropped"), &GlobalInput::get_event_stream_dropped);
+
+    ClassDB::bind_method(D_METHOD("set_keyboard_layout", "layout", "variant"), &GlobalInput::set_keyboard_layout, DEFVAL(""));
+    ClassDB::bind_method(D_METHOD("get_keyboard_layout"), &GlobalInput::get_keyboard_layout);
+
+    ADD_PROPERTY(PropertyInfo(Variant::STRING, "backend", PROPERTY_HINT_ENUM, "auto,windows,evdev,x11,xinput2,dummy"),
                  "set_backend", "get_backend");
 
     ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_physics_frames"), 
                  "set_use_physics_frames", "get_use_physics_frames");
+
+    ADD_PROPERTY(PropertyInfo(Variant::STRING, "keyboard_layout"),
+                 "set_keyboard_layout", "get_keyboard_layout");
+
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "async_start"),
+                 "set_async_start", "get_async_start");
+
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "power_saving"),
+                 "set_power_saving", "get_power_saving");
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "debounce_ms", PROPERTY_HINT_RANGE, "0,100,1,suffix:ms"),
+                 "set_debounce_ms", "get_debounce_ms");
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "debounce_mode", PROPERTY_HINT_ENUM, "eager,deferred"),
+                 "set_debounce_mode", "get_debounce_mode");
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "hook_thread_nice", PROPERTY_HINT_RANGE, "-20,19,1"),
+                 "set_hook_thread_nice", "get_hook_thread_nice");
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "hook_thread_fifo_priority", PROPERTY_HINT_RANGE, "0,99,1"),
+                 "set_hook_thread_fifo_priority", "get_hook_thread_fifo_priority");
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "hook_thread_affinity"),
+                 "set_hook_thread_affinity", "get_hook_thread_affinity");
+
+    ADD_PROPERTY(PropertyInfo(Variant::STRING, "hook_thread_name"),
+                 "set_hook_thread_name", "get_hook_thread_name");
+
+    ADD_PROPERTY(PropertyInfo(Variant::STRING, "shared_memory_name"),
+                 "set_shared_memory_name", "get_shared_memory_name");
+
+    ADD_PROPERTY(PropertyInfo(Variant::STRING, "event_stream_path"),
+                 "set_event_stream_path", "get_event_stream_path");
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "mouse_motion_mode", PROPERTY_HINT_ENUM, "coalesced,path"),
+                 "set_mouse_motion_mode", "get_mouse_motion_mode");
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "joy_deadzone", PROPERTY_HINT_RANGE, "0,1,0.01"),
+                 "set_joy_deadzone", "get_joy_deadzone");
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "action_buffer_ms", PROPERTY_HINT_RANGE, "0,1000,1,suffix:ms"),
+                 "set_action_buffer_ms", "get_action_buffer_ms");
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "action_repeat_delay_ms", PROPERTY_HINT_RANGE, "0,2000,1,suffix:ms"),
+                 "set_action_repeat_delay_ms", "get_action_repeat_delay_ms");
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "action_repeat_rate", PROPERTY_HINT_RANGE, "0.1,100,0.1,suffix:/s"),
+                 "set_action_repeat_rate", "get_action_repeat_rate");
+
+    ADD_PROPERTY(PropertyInfo(Variant::PACKED_INT32_ARRAY, "tracked_keys"),
+                 "set_tracked_keys", "get_tracked_keys");
+
+    ADD_PROPERTY(PropertyInfo(Variant::PACKED_STRING_ARRAY, "snapshot_actions"),
+                 "set_snapshot_actions", "get_snapshot_actions");
+
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "thread_safe_reads"),
+                 "set_thread_safe_reads", "get_thread_safe_reads");
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "history_size", PROPERTY_HINT_RANGE, "0,3600,1,suffix:ticks"),
+                 "set_history_size", "get_history_size");
+
+    ADD_SIGNAL(MethodInfo("hook_ready", PropertyInfo(Variant::ARRAY, "devices")));
+
+    ClassDB::bind_integer_constant(get_class_static(), "", "MODIFIER_LEFT_SHIFT", GlobalInputCommon::MODIFIER_LEFT_SHIFT);
+    ClassDB::bind_integer_constant(get_class_static(), "", "MODIFIER_RIGHT_SHIFT", GlobalInputCommon::MODIFIER_RIGHT_SHIFT);
+    ClassDB::bind_integer_constant(get_class_static(), "", "MODIFIER_LEFT_CTRL", GlobalInputCommon::MODIFIER_LEFT_CTRL);
+    ClassDB::bind_integer_constant(get_class_static(), "", "MODIFIER_RIGHT_CTRL", GlobalInputCommon::MODIFIER_RIGHT_CTRL);
+    ClassDB::bind_integer_constant(get_class_static(), "", "MODIFIER_LEFT_ALT", GlobalInputCommon::MODIFIER_LEFT_ALT);
+    ClassDB::bind_integer_constant(get_class_static(), "", "MODIFIER_RIGHT_ALT", GlobalInputCommon::MODIFIER_RIGHT_ALT);
+    ClassDB::bind_integer_constant(get_class_static(), "", "MODIFIER_LEFT_META", GlobalInputCommon::MODIFIER_LEFT_META);
+    ClassDB::bind_integer_constant(get_class_static(), "", "MODIFIER_RIGHT_META", GlobalInputCommon::MODIFIER_RIGHT_META);
+    ClassDB::bind_integer_constant(get_class_static(), "", "MODIFIER_SHIFT", GlobalInputCommon::MODIFIER_SHIFT);
+    ClassDB::bind_integer_constant(get_class_static(), "", "MODIFIER_CTRL", GlobalInputCommon::MODIFIER_CTRL);
+    ClassDB::bind_integer_constant(get_class_static(), "", "MODIFIER_ALT", GlobalInputCommon::MODIFIER_ALT);
+    ClassDB::bind_integer_constant(get_class_static(), "", "MODIFIER_META", GlobalInputCommon::MODIFIER_META);
 }
 
 void GlobalInput::set_backend(const String &backend_name) {
@@ -63,29 +229,252 @@ void GlobalInput::set_backend(const String &backend_name) {
     hook_started = false;
     selected_backend = new_backend;
 
-    check_backend();
-
-    if (backend.is_valid()){
-        hook_started = true;
-        backend->start();
-    } 
-    else godot::print_line("Invalid Backend");
+    start_backend();
 }
 
 String GlobalInput::get_backend() { return selected_backend; }
 
+String GlobalInput::get_active_backend() const {
+    if (!backend.is_valid()) return String();
+
+    switch (active_backend) {
+        case BACKEND_WINDOWS: return "windows";
+        case BACKEND_EVDEV: return "evdev";
+        case BACKEND_XINPUT2: return "xinput2";
+        default: return "dummy";
+    }
+}
+
+void GlobalInput::set_keyboard_layout(const String &layout, const String &variant) {
+    keyboard_layout = layout;
+    keyboard_variant = variant;
+
+    if (backend.is_valid()) backend->set_keyboard_layout(keyboard_layout, keyboard_variant);
+}
+
+void GlobalInput::set_joy_deadzone(float deadzone) {
+    joy_deadzone = deadzone;
+    joy_deadzone_set = true;
+
+    if (backend.is_valid()) backend->set_joy_deadzone(joy_deadzone);
+}
+
+void GlobalInput::set_hook_thread_nice(int nice) {
+    thread_config.nice = nice;
+    update_thread_config();
+}
+
+void GlobalInput::set_hook_thread_fifo_priority(int priority) {
+    thread_config.fifo_priority = priority;
+    update_thread_config();
+}
+
+void GlobalInput::set_hook_thread_affinity(int64_t mask) {
+    thread_config.affinity_mask = mask;
+    update_thread_config();
+}
+
+void GlobalInput::set_hook_thread_name(const String &name) {
+    thread_config.name = name;
+    update_thread_config();
+}
+
+String GlobalInput::get_hook_thread_error() { return backend.is_valid() ? backend->get_thread_config_error() : String(); }
+
+// Settings made before start_hook() are applied when the backend starts. A node
+// that made none leaves the shared hook thread as other nodes set it.
+void GlobalInput::update_thread_config() {
+    thread_config_set = true;
+    if (backend.is_valid() && hook_started) backend->set_thread_config(thread_config);
+}
+
+void GlobalInput::set_shared_memory_name(const String &name) {
+    shared_memory_name = name;
+
+    if (backend.is_valid() && hook_started) backend->set_shared_memory_name(shared_memory_name);
+}
+
+void GlobalInput::set_event_stream_path(const String &path) {
+    event_stream_path = path;
+
+    if (backend.is_valid() && hook_started) backend->set_event_stream_path(event_stream_path);
+}
+
+int64_t GlobalInput::get_event_stream_dropped() { return backend.is_valid() ? backend->get_event_stream_dropped() : 0; }
+
+void GlobalInput::set_power_saving(bool enabled) {
+    power_saving = enabled;
+    power_saving_set = true;
+
+    if (backend.is_valid()) backend->set_power_saving(power_saving);
+}
+
+void GlobalInput::set_debounce_ms(int msec) {
+    debounce_ms = msec;
+    debounce_set = true;
+
+    if (backend.is_valid()) backend->set_debounce(debounce_mode, debounce_ms);
+}
+
+void GlobalInput::set_debounce_mode(int mode) {
+    debounce_mode = mode;
+    debounce_set = true;
+
+    if (backend.is_valid()) backend->set_debounce(debounce_mode, debounce_ms);
+}
+
+void GlobalInput::set_key_debounce(int key, int msec) {
+    if (msec < 0) key_debounce.erase(key);
+    else key_debounce[key] = msec;
+
+    if (backend.is_valid()) backend->set_key_debounce(key, msec);
+}
+
+void GlobalInput::set_tracked_keys(const PackedInt32Array &keys) {
+    tracked_keys = keys;
+
+    if (backend.is_valid()) backend->set_tracked_keys(tracked_keys);
+}
+
+// Keys bound by keycode and by physical keycode, mouse and joypad events need no tracking.
+void GlobalInput::track_action(const String &action) {
+    if (!InputMap::get_singleton() || !InputMap::get_singleton()->has_action(action)) {
+        godot::print_line("Global Input: Unknown action " + action);
+        return;
+    }
+
+    PackedInt32Array keys = tracked_keys;
+    const Array events = InputMap::get_singleton()->action_get_events(action);
+    for (int i = 0; i < events.size(); i++) {
+        Ref<InputEventKey> key_ev = events[i];
+        if (key_ev.is_null()) continue;
+
+        for (int key : { (int)key_ev->get_keycode(), (int)key_ev->get_physical_keycode() }) {
+            if (key != KEY_NONE && !keys.has(key)) keys.push_back(key);
+        }
+    }
+    set_tracked_keys(keys);
+}
+
+void GlobalInput::clear_tracked_keys() { set_tracked_keys(PackedInt32Array()); }
+
+// Captured on the first call, then right after each poll so the whole frame sees one state.
+Ref<InputSnapshot> GlobalInput::get_frame_snapshot() {
+    if (frame_snapshot.is_null()) capture_snapshot();
+    return frame_snapshot;
+}
+
+void GlobalInput::set_thread_safe_reads(bool enabled) {
+    thread_safe_reads = enabled;
+    if (enabled) capture_snapshot();
+}
+
+void GlobalInput::set_snapshot_actions(const PackedStringArray &actions) {
+    snapshot_actions = actions;
+    if (frame_snapshot.is_valid()) capture_snapshot();
+}
+
+// Everything built on the frame snapshot, skipped while nothing uses it. The
+// history alone keeps no actions, so it gets a capture without any.
+void GlobalInput::finish_frame(uint64_t tick) {
+    if (frame_snapshot.is_valid() || thread_safe_reads) {
+        capture_snapshot();
+        history.record(tick, **frame_snapshot);
+    } else if (history.get_capacity() > 0 && backend.is_valid()) {
+        if (history_snapshot.is_null()) history_snapshot.instantiate();
+        backend->capture_snapshot(**history_snapshot);
+        history.record(tick, **history_snapshot);
+    }
+}
+
+void GlobalInput::set_history_size(int ticks) {
+    if (ticks == history.get_capacity()) return;
+    history.set_capacity(ticks);
+}
+
+bool GlobalInput::get_key_state_at(int64_t tick, int key) {
+    return tick >= 0 && history.get_key_state((uint64_t)tick, key);
+}
+
+// A new snapshot per call, null when the tick isn't in the history.
+Ref<InputSnapshot> GlobalInput::get_snapshot_at(int64_t tick) {
+    Ref<InputSnapshot> snapshot;
+    if (tick < 0 || !history.has_tick((uint64_t)tick)) return snapshot;
+    snapshot.instantiate();
+    if (!history.get_snapshot((uint64_t)tick, **snapshot)) snapshot.unref();
+    return snapshot;
+}
+
+void GlobalInput::capture_snapshot() {
+    if (frame_snapshot.is_null()) frame_snapshot.instantiate();
+
+    frame_snapshot->set_actions(snapshot_actions);
+
+    if (backend.is_valid()) backend->capture_snapshot(**frame_snapshot);
+    else frame_snapshot->begin(0);
+
+    if (thread_safe_reads) published.publish(**frame_snapshot);
+}
+
+int64_t GlobalInput::get_debounce_suppressed() { return backend.is_valid() ? backend->get_debounce_suppressed() : 0; }
+
+double GlobalInput::get_hook_wakeups_per_second() { return backend.is_valid() ? backend->get_hook_wakeups_per_second() : 0.0; }
+
+void GlobalInput::set_mouse_motion_mode(int mode) {
+    mouse_motion_mode = mode;
+
+    if (backend.is_valid()) backend->set_motion_mode(mouse_motion_mode);
+}
+
 void GlobalInput::start_hook() {
     if (hook_started) return;
 
+    start_backend();
+}
+
+void GlobalInput::start_backend() {
     check_backend();
 
     if (backend.is_valid()){
         hook_started = true;
+        hook_ready_emitted = false;
+        hook_failure_reported = false;
+        backend->async_start = async_start;
+        backend->set_keyboard_layout(keyboard_layout, keyboard_variant);
+        if (joy_deadzone_set) backend->set_joy_deadzone(joy_deadzone);
+        backend->set_motion_mode(mouse_motion_mode);
+        if (power_saving_set) backend->set_power_saving(power_saving);
+        if (debounce_set) backend->set_debounce(debounce_mode, debounce_ms);
+        Array debounced_keys = key_debounce.keys();
+        for (int i = 0; i < debounced_keys.size(); i++) {
+            backend->set_key_debounce(debounced_keys[i], key_debounce[debounced_keys[i]]);
+        }
+        backend->set_tracked_keys(tracked_keys);
+        if (thread_config_set) backend->set_thread_config(thread_config);
+        backend->set_shared_memory_name(shared_memory_name);
+        backend->set_event_stream_path(event_stream_path);
+        for (int i = 0; i < virtual_devices.size(); i++) {
+            Dictionary device = virtual_devices[i];
+            backend->add_virtual_device(device["path"], device["role"], device["name"]);
+        }
         backend->start();
     } 
     else godot::print_line("Invalid Backend");
 }
 
+// Emits hook_ready on the first frame after the backend finished opening its devices.
+void GlobalInput::check_hook_ready() {
+    if (hook_ready_emitted || !backend.is_valid()) return;
+
+    if (backend->is_hook_ready()) {
+        hook_ready_emitted = true;
+        emit_signal("hook_ready", backend->get_devices());
+    } else if (backend->is_hook_failed() && !hook_failure_reported) {
+        hook_failure_reported = true;
+        godot::print_line("Global Input: The input hook failed to start.");
+    }
+}
+
 void GlobalInput::stop_hook() {
     if (!hook_started) return;
     hook_started = false;
@@ -98,19 +487,23 @@ void GlobalInput::stop_hook() {
 
 void GlobalInput::_process(double delta) {
     if (!hook_started) return;
+    check_hook_ready();
     if (use_physics_frames) return;
     if (backend.is_valid()) {
         backend->poll_data();
         backend->increment_frame();
+        finish_frame(Engine::get_singleton() ? Engine::get_singleton()->get_process_frames() : 0);
         }
 }
 
 void GlobalInput::_physics_process(double delta) {
     if (!hook_started) return;
     if (!use_physics_frames) return;
+    check_hook_ready();
     if (backend.is_valid()) {
         backend->poll_data();
         backend->increment_frame();
+        finish_frame(Engine::get_singleton() ? Engine::get_singleton()->get_physics_frames() : 0);
         }
 
 }
@@ -122,23 +515,207 @@ void GlobalInput::_input(const Ref<InputEvent> &event){
 }
 
 // --- Input Checks ---
-Vector2 GlobalInput::get_mouse_position() { return backend.is_valid() ? backend->get_mouse_position() : Vector2(); }
-bool GlobalInput::is_key_pressed(int key) { return backend.is_valid() && backend->is_key_pressed(key); }
-bool GlobalInput::is_key_just_pressed(int key) { return backend.is_valid() && backend->is_key_just_pressed(key); }
-bool GlobalInput::is_key_just_released(int key) { return backend.is_valid() && backend->is_key_just_released(key); }
-bool GlobalInput::is_mouse_pressed(int button) { return backend.is_valid() && backend->is_mouse_pressed(button); }
-bool GlobalInput::is_mouse_just_pressed(int button) { return backend.is_valid() && backend->is_mouse_just_pressed(button); }
-bool GlobalInput::is_mouse_just_released(int button) { return backend.is_valid() && backend->is_mouse_just_released(button); }
-
-bool GlobalInput::is_action_pressed(const String &action) { return backend.is_valid() && backend->is_action_pressed(action); }
-bool GlobalInput::is_action_just_pressed(const String &action) { return backend.is_valid() && backend->is_action_just_pressed(action); }
-bool GlobalInput::is_action_just_released(const String &action) { return backend.is_valid() && backend->is_action_just_released(action); }
+// Worker threads read the published frame and never reach the backend.
+bool GlobalInput::from_worker() const {
+    if (!thread_safe_reads.load(std::memory_order_relaxed)) return false;
+    OS *os = OS::get_singleton();
+    return os && os->get_thread_caller_id() != os->get_main_thread_id();
+}
+
+// Queries the published frame can't answer. With thread_safe_reads on they
+// answer nothing off the main thread rather than reach the hub from a worker.
+bool GlobalInput::main_thread_only(const char *query) {
+    if (!from_worker()) return false;
+    if (!worker_call_reported.exchange(true)) {
+        godot::print_line("Global Input: " + String(query) + "() is main thread only, it reads as released off it.");
+    }
+    return true;
+}
+
+Vector2 GlobalInput::get_mouse_position() {
+    if (from_worker()) return published.get_mouse_position();
+    return backend.is_valid() ? backend->get_mouse_position() : Vector2();
+}
+
+bool GlobalInput::is_key_pressed(int key) {
+    if (from_worker()) return published.test_key(InputSnapshot::STATE_PRESSED, key);
+    return backend.is_valid() && backend->is_key_pressed(key);
+}
+
+bool GlobalInput::is_key_just_pressed(int key) {
+    if (from_worker()) return published.test_key(InputSnapshot::STATE_JUST_PRESSED, key);
+    return backend.is_valid() && backend->is_key_just_pressed(key);
+}
+
+bool GlobalInput::is_key_just_released(int key) {
+    if (from_worker()) return published.test_key(InputSnapshot::STATE_JUST_RELEASED, key);
+    return backend.is_valid() && backend->is_key_just_released(key);
+}
+
+bool GlobalInput::is_physical_key_pressed(int key) {
+    if (main_thread_only("is_physical_key_pressed")) return false;
+    return backend.is_valid() && backend->is_physical_key_pressed(key);
+}
+
+bool GlobalInput::is_scancode_pressed(int code) {
+    if (main_thread_only("is_scancode_pressed")) return false;
+    return backend.is_valid() && backend->is_scancode_pressed(code);
+}
+
+bool GlobalInput::is_mouse_pressed(int button) {
+    if (from_worker()) return published.test_mouse(InputSnapshot::STATE_PRESSED, button);
+    return backend.is_valid() && backend->is_mouse_pressed(button);
+}
+
+bool GlobalInput::is_mouse_just_pressed(int button) {
+    if (from_worker()) return published.test_mouse(InputSnapshot::STATE_JUST_PRESSED, button);
+    return backend.is_valid() && backend->is_mouse_just_pressed(button);
+}
+
+bool GlobalInput::is_mouse_just_released(int button) {
+    if (from_worker()) return published.test_mouse(InputSnapshot::STATE_JUST_RELEASED, button);
+    return backend.is_valid() && backend->is_mouse_just_released(button);
+}
+
+bool GlobalInput::is_action_pressed(const String &action) {
+    if (from_worker()) return published.test_action(InputSnapshot::STATE_PRESSED, action);
+    return backend.is_valid() && backend->is_action_pressed(action);
+}
+
+bool GlobalInput::is_action_just_pressed(const String &action) {
+    if (from_worker()) return published.test_action(InputSnapshot::STATE_JUST_PRESSED, action);
+    return backend.is_valid() && backend->is_action_just_pressed(action);
+}
+
+bool GlobalInput::is_action_just_released(const String &action) {
+    if (from_worker()) return published.test_action(InputSnapshot::STATE_JUST_RELEASED, action);
+    return backend.is_valid() && backend->is_action_just_released(action);
+}
+
+bool GlobalInput::is_key_echo(int key) {
+    if (main_thread_only("is_key_echo")) return false;
+    return backend.is_valid() && backend->is_key_echo(key);
+}
+
+int GlobalInput::get_key_repeat_count(int key) {
+    if (main_thread_only("get_key_repeat_count")) return 0;
+    return backend.is_valid() ? backend->get_key_repeat_count(key) : 0;
+}
+
+bool GlobalInput::is_action_repeating(const String &action) {
+    if (main_thread_only("is_action_repeating") || !backend.is_valid()) return false;
+    if (!action_repeats.has(action)) return backend->is_action_repeating(action, action_repeat_delay_ms, action_repeat_rate);
+
+    Vector2 timing = action_repeats[action];
+    return backend->is_action_repeating(action, (int)timing.x, timing.y);
+}
+
+void GlobalInput::set_action_repeat(const String &action, int delay_ms, float rate) {
+    action_repeats[action] = Vector2((float)delay_ms, rate);
+}
+
+void GlobalInput::clear_action_repeat(const String &action) {
+    action_repeats.erase(action);
+}
+
+bool GlobalInput::is_key_pressed_within(int key, int msec) {
+    if (main_thread_only("is_key_pressed_within")) return false;
+    return backend.is_valid() && backend->is_key_pressed_within(key, msec);
+}
+
+bool GlobalInput::is_mouse_pressed_within(int button, int msec) {
+    if (main_thread_only("is_mouse_pressed_within")) return false;
+    return backend.is_valid() && backend->is_mouse_pressed_within(button, msec);
+}
+
+bool GlobalInput::is_action_buffered(const String &action, int msec) {
+    if (main_thread_only("is_action_buffered") || !backend.is_valid()) return false;
+    if (msec < 0) msec = get_action_buffer(action);
+    return backend->is_action_buffered(action, msec);
+}
+
+// A negative window removes the action's own setting.
+void GlobalInput::set_action_buffer(const String &action, int msec) {
+    if (msec < 0) action_buffers.erase(action);
+    else action_buffers[action] = msec;
+}
+
+int GlobalInput::get_action_buffer(const String &action) const {
+    return action_buffers.get(action, action_buffer_ms);
+}
+Vector2 GlobalInput::get_mouse_delta() {
+    if (from_worker()) return published.get_mouse_delta();
+    return backend.is_valid() ? backend->get_mouse_delta() : Vector2();
+}
+
+PackedVector2Array GlobalInput::get_mouse_path() {
+    if (main_thread_only("get_mouse_path")) return PackedVector2Array();
+    return backend.is_valid() ? backend->get_mouse_path() : PackedVector2Array();
+}
+
+Vector2 GlobalInput::get_mouse_velocity() {
+    if (main_thread_only("get_mouse_velocity")) return Vector2();
+    return backend.is_valid() ? backend->get_mouse_velocity() : Vector2();
+}
+
+Vector2 GlobalInput::get_mouse_acceleration() {
+    if (main_thread_only("get_mouse_acceleration")) return Vector2();
+    return backend.is_valid() ? backend->get_mouse_acceleration() : Vector2();
+}
+
+float GlobalInput::get_pen_pressure() {
+    if (main_thread_only("get_pen_pressure")) return 0.0f;
+    return backend.is_valid() ? backend->get_pen_pressure() : 0.0f;
+}
+
+Vector2 GlobalInput::get_pen_tilt() {
+    if (main_thread_only("get_pen_tilt")) return Vector2();
+    return backend.is_valid() ? backend->get_pen_tilt() : Vector2();
+}
+
+bool GlobalInput::is_joy_button_pressed(int device, int button) {
+    if (main_thread_only("is_joy_button_pressed")) return false;
+    return backend.is_valid() && backend->is_joy_button_pressed(device, button);
+}
+
+float GlobalInput::get_joy_axis(int device, int axis) {
+    if (main_thread_only("get_joy_axis")) return 0.0f;
+    return backend.is_valid() ? backend->get_joy_axis(device, axis) : 0.0f;
+}
 
 Dictionary GlobalInput::get_keys_pressed_detailed() { return backend.is_valid() ? backend->get_keys_pressed_detailed() : Dictionary(); }
 Dictionary GlobalInput::get_keys_just_pressed_detailed() { return backend.is_valid() ? backend->get_keys_just_pressed_detailed() : Dictionary(); }
 Dictionary GlobalInput::get_keys_just_released_detailed() { return backend.is_valid() ? backend->get_keys_just_released_detailed() : Dictionary(); }
 
-bool GlobalInput::is_shift_pressed() { return backend.is_valid() && backend->is_shift_pressed(); }
-bool GlobalInput::is_ctrl_pressed() { return backend.is_valid() && backend->is_ctrl_pressed(); }
-bool GlobalInput::is_alt_pressed() { return backend.is_valid() && backend->is_alt_pressed(); }
-bool GlobalInput::is_meta_pressed() { return backend.is_valid() && backend->is_meta_pressed(); }
+Array GlobalInput::get_devices() { return backend.is_valid() ? backend->get_devices() : Array(); }
+
+// A path added again replaces its earlier role and name.
+bool GlobalInput::add_virtual_device(const String &path, const String &role, const String &name) {
+    Dictionary device;
+    device["path"] = path;
+    device["role"] = role;
+    device["name"] = name;
+
+    bool replaced = false;
+    for (int i = 0; i < virtual_devices.size() && !replaced; i++) {
+        Dictionary existing = virtual_devices[i];
+        if (String(existing["path"]) != path) continue;
+        virtual_devices[i] = device;
+        replaced = true;
+    }
+    if (!replaced) virtual_devices.push_back(device);
+
+    if (hook_started && backend.is_valid()) return backend->add_virtual_device(path, role, name);
+    return true;
+}
+
+bool GlobalInput::is_shift_pressed() { return is_modifier_pressed(GlobalInputCommon::MODIFIER_SHIFT); }
+bool GlobalInput::is_ctrl_pressed() { return is_modifier_pressed(GlobalInputCommon::MODIFIER_CTRL); }
+bool GlobalInput::is_alt_pressed() { return is_modifier_pressed(GlobalInputCommon::MODIFIER_ALT); }
+bool GlobalInput::is_meta_pressed() { return is_modifier_pressed(GlobalInputCommon::MODIFIER_META); }
+
+int64_t GlobalInput::get_modifier_mask() {
+    if (from_worker()) return published.get_modifier_mask();
+    return backend.is_valid() ? backend->get_modifier_mask() : 0;
+}
+bool GlobalInput::is_modifier_pressed(int64_t modifiers) { return (get_modifier_mask() & modifiers) != 0; }
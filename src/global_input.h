@@ -9,9 +9,12 @@
 
 #ifdef __linux__
 #include "trackers/linux/x11_global_input.h"
+#include "trackers/linux/xinput2_global_input.h"
 #endif
 
 #include "trackers/dummy.h"
+#include "published_input.h"
+#include "input_history.h"
 
 #include "godot_cpp/classes/node.hpp"
 #include "godot_cpp/core/class_db.hpp"
@@ -37,6 +40,57 @@ public:
     void set_use_physics_frames(bool p_use) { use_physics_frames = p_use; }
     bool get_use_physics_frames() const { return use_physics_frames; }
 
+    // Async starts enumerate devices on the hook thread and emit hook_ready when done.
+    void set_async_start(bool p_async) { async_start = p_async; }
+    bool get_async_start() const { return async_start; }
+    bool is_hook_ready() const { return hook_ready_emitted; }
+
+    // Lets the hook thread sleep until input arrives instead of polling on a timer.
+    void set_power_saving(bool enabled);
+    bool get_power_saving() const { return power_saving; }
+    double get_hook_wakeups_per_second();
+
+    // Linux: drops switch chatter, edges that follow another edge of the same key
+    // within debounce_ms. 0 disables it; set_key_debounce() overrides per key and
+    // a negative window removes the override.
+    void set_debounce_ms(int msec);
+    int get_debounce_ms() const { return debounce_ms; }
+    void set_debounce_mode(int mode);
+    int get_debounce_mode() const { return debounce_mode; }
+    void set_key_debounce(int keycode, int msec);
+    int64_t get_debounce_suppressed();
+
+    // Keys the hook decodes, everything while empty. On Linux the kernel drops
+    // the others before they reach the hook thread. track_action() adds the keys
+    // an InputMap action is bound to.
+    void set_tracked_keys(const PackedInt32Array &keys);
+    PackedInt32Array get_tracked_keys() const { return tracked_keys; }
+    void track_action(const String &action);
+    void clear_tracked_keys();
+
+    // Hook thread scheduling, applied when the hook starts. get_hook_thread_error()
+    // describes any setting the OS refused, empty when all were applied.
+    void set_hook_thread_nice(int nice);
+    int get_hook_thread_nice() const { return thread_config.nice; }
+    void set_hook_thread_fifo_priority(int priority);
+    int get_hook_thread_fifo_priority() const { return thread_config.fifo_priority; }
+    void set_hook_thread_affinity(int64_t mask);
+    int64_t get_hook_thread_affinity() const { return thread_config.affinity_mask; }
+    void set_hook_thread_name(const String &name);
+    String get_hook_thread_name() const { return thread_config.name; }
+    String get_hook_thread_error();
+
+    // Publishes key, mouse and event state into this shared memory region for
+    // other local processes (layout in trackers/shared_state.h). Empty disables it.
+    void set_shared_memory_name(const String &name);
+    String get_shared_memory_name() const { return shared_memory_name; }
+
+    // Linux: streams key and button edges to clients of this Unix socket
+    // (protocol in trackers/linux/event_stream_server.h). Empty disables it.
+    void set_event_stream_path(const String &path);
+    String get_event_stream_path() const { return event_stream_path; }
+    int64_t get_event_stream_dropped();
+
 
     void _process(double delta) override;
     void _physics_process(double delta) override;
@@ -44,18 +98,93 @@ public:
 
     // Input Checks
     Vector2 get_mouse_position();
+    // Raw pointer motion since the previous frame, and its smoothed rate of change.
+    Vector2 get_mouse_delta();
+    Vector2 get_mouse_velocity();
+    Vector2 get_mouse_acceleration();
+    // Cursor position after every hardware report of the last frame, in "path" motion mode.
+    PackedVector2Array get_mouse_path();
+    void set_mouse_motion_mode(int mode);
+    int get_mouse_motion_mode() const { return mouse_motion_mode; }
     bool is_key_pressed(int keycode);
     bool is_key_just_pressed(int keycode);
     bool is_key_just_released(int keycode);
+    // By position: Godot physical keycodes (US QWERTY names) whatever the layout,
+    // and raw backend scancodes (evdev codes on Linux) for keys no layout maps.
+    bool is_physical_key_pressed(int keycode);
+    bool is_scancode_pressed(int scancode);
     bool is_mouse_pressed(int button);
     bool is_mouse_just_pressed(int button);
     bool is_mouse_just_released(int button);
 
+    // Pen tablets
+    float get_pen_pressure();
+    Vector2 get_pen_tilt();
+
+    // Joypads, device is the joypad index reported by get_devices().
+    bool is_joy_button_pressed(int device, int button);
+    float get_joy_axis(int device, int axis);
+    void set_joy_deadzone(float deadzone);
+    float get_joy_deadzone() const { return joy_deadzone; }
+
     // Actions
     bool is_action_pressed(const String &action_name);
     bool is_action_just_pressed(const String &action_name);
     bool is_action_just_released(const String &action_name);
 
+    // Key repeat. Echo means the OS repeated the held key during the last frame;
+    // the count is OS repeats since the key went down.
+    bool is_key_echo(int keycode);
+    int get_key_repeat_count(int keycode);
+    // True when the action is pressed and on each repeat synthesized from the press
+    // time, after `delay_ms` then `rate` per second. Actions without their own
+    // set_action_repeat() use action_repeat_delay_ms and action_repeat_rate.
+    bool is_action_repeating(const String &action_name);
+    void set_action_repeat(const String &action_name, int delay_ms, float rate);
+    void clear_action_repeat(const String &action_name);
+    void set_action_repeat_delay_ms(int msec) { action_repeat_delay_ms = msec; }
+    int get_action_repeat_delay_ms() const { return action_repeat_delay_ms; }
+    void set_action_repeat_rate(float rate) { action_repeat_rate = rate; }
+    float get_action_repeat_rate() const { return action_repeat_rate; }
+
+    // Time based buffers, independent of frame rate: was the last press at most
+    // `msec` ago. For actions -1 uses the window set with set_action_buffer(),
+    // or action_buffer_ms for actions without one.
+    bool is_key_pressed_within(int keycode, int msec);
+    bool is_mouse_pressed_within(int button, int msec);
+    bool is_action_buffered(const String &action_name, int msec = -1);
+    void set_action_buffer(const String &action_name, int msec);
+    int get_action_buffer(const String &action_name) const;
+    void set_action_buffer_ms(int msec) { action_buffer_ms = msec; }
+    int get_action_buffer_ms() const { return action_buffer_ms; }
+
+    // The frame's keys, buttons, modifiers, pointer and actions read all at once.
+    // Always the same object, refilled each frame once it has been asked for, so
+    // copy what has to outlive the frame. Lists only the actions in
+    // snapshot_actions, every one of them costs a match per frame.
+    Ref<InputSnapshot> get_frame_snapshot();
+    void set_snapshot_actions(const PackedStringArray &actions);
+    PackedStringArray get_snapshot_actions() const { return snapshot_actions; }
+
+    // Lets WorkerThreadPool tasks and other threads call the key, mouse, modifier,
+    // pointer and action queries. Off the main thread those read the last frame
+    // snapshot, published behind a seqlock, so readers never block each other or
+    // the hook. Other queries, and the snapshot object itself, stay main thread only;
+    // off it they read as released or zero and print an error once.
+    void set_thread_safe_reads(bool enabled);
+    bool get_thread_safe_reads() const { return thread_safe_reads; }
+
+    // Rollback history of the last history_size ticks (0 disables it), recorded
+    // at each frame boundary. Ticks are Engine.get_physics_frames() with
+    // use_physics_frames, Engine.get_process_frames() otherwise. Keys, mouse
+    // buttons, modifiers and pointer are kept, actions are not. Resizing clears it.
+    void set_history_size(int ticks);
+    int get_history_size() const { return history.get_capacity(); }
+    bool get_key_state_at(int64_t tick, int key);
+    Ref<InputSnapshot> get_snapshot_at(int64_t tick);
+    int64_t get_history_oldest_tick() const { return history.get_oldest_tick(); }
+    int64_t get_history_newest_tick() const { return history.get_newest_tick(); }
+
     // Get Details
     Dictionary get_keys_pressed_detailed();
     Dictionary get_keys_just_pressed_detailed();
@@ -66,60 +195,137 @@ public:
     bool is_ctrl_pressed();
     bool is_alt_pressed();
     bool is_meta_pressed();
+    // Left/right aware: one MODIFIER_* bit per physical key, and is_modifier_pressed()
+    // is true if any key in `modifiers` is held, e.g. MODIFIER_RIGHT_ALT or MODIFIER_CTRL.
+    int64_t get_modifier_mask();
+    bool is_modifier_pressed(int64_t modifiers);
 
 
-    // Backend selection
+    // Backend selection: "windows", "evdev" (Linux /dev/input, on X11 and Wayland
+    // alike; "x11" is an alias), "xinput2" (X server raw events, no input group,
+    // built with use_xinput2=yes), "dummy", or "auto", which picks the first native
+    // backend that can actually read input. get_active_backend() tells which one runs.
     void set_backend(const String &backend_name);
     String get_backend();
+    String get_active_backend() const;
+
+    // Devices opened by the backend, each a Dictionary with path, name and role.
+    Array get_devices();
+
+    // Linux: reads raw input_event records from a FIFO, socket or file as a device
+    // with the capabilities of `role` (keyboard, pointer, combo or joystick).
+    // Kept for every later start; added right away if the hook is running.
+    bool add_virtual_device(const String &path, const String &role, const String &name = "");
+
+    // Keyboard layout used to translate raw scancodes. Empty means the system layout.
+    void set_keyboard_layout(const String &layout, const String &variant = "");
+    String get_keyboard_layout() const { return keyboard_layout; }
 
 private:
     enum BackendType {
         BACKEND_WINDOWS,
-        BACKEND_X11,
+        BACKEND_EVDEV,
+        BACKEND_XINPUT2,
         BACKEND_DUMMY
     };
 
     BackendType active_backend = BACKEND_DUMMY;
     Ref<GlobalInputCommon> backend;
 
-    static bool hook_started;
-    static bool use_physics_frames;
+    bool hook_started = false;
+    bool use_physics_frames = false;
+    bool async_start = false;
+    bool hook_ready_emitted = false;
+    bool hook_failure_reported = false;
     String selected_backend = "dummy";
+    String keyboard_layout;
+    String keyboard_variant;
+    int mouse_motion_mode = GlobalInputCommon::MOTION_COALESCED;
+    // The hub is shared, the *_set flags keep a node that never set something
+    // from overriding other nodes' setting.
+    float joy_deadzone = 0.2f;
+    bool joy_deadzone_set = false;
+    bool power_saving = false;
+    bool power_saving_set = false;
+    int debounce_ms = 0;
+    int debounce_mode = GlobalInputCommon::DEBOUNCE_EAGER;
+    bool debounce_set = false;
+    Dictionary key_debounce;
+    PackedInt32Array tracked_keys;
+    HookThreadConfig thread_config;
+    bool thread_config_set = false;
+    String shared_memory_name;
+    String event_stream_path;
+    Array virtual_devices;
+    Dictionary action_buffers;
+    int action_buffer_ms = 100;
+    Dictionary action_repeats;
+    int action_repeat_delay_ms = 400;
+    float action_repeat_rate = 20.0f;
+    Ref<InputSnapshot> frame_snapshot;
+    PackedStringArray snapshot_actions;
+    std::atomic<bool> thread_safe_reads{false};
+    std::atomic<bool> worker_call_reported{false};
+    PublishedInput published;
+    InputHistory history;
+    Ref<InputSnapshot> history_snapshot; // keys and mouse only, while nothing else wants a snapshot
+
+    void start_backend();
+    void capture_snapshot();
+    void finish_frame(uint64_t tick);
+    bool from_worker() const;
+    bool main_thread_only(const char *query);
+    void check_hook_ready();
+    void update_thread_config();
 
     void check_backend(){
+        String name = resolve_backend(selected_backend);
 
         #ifdef _WIN32
-            if (selected_backend == "windows") {
+            if (name == "windows") {
                 backend = Ref<WindowsGlobalInput>(memnew(WindowsGlobalInput));
                 active_backend = BACKEND_WINDOWS;
-            } 
-            else {
-                backend = Ref<DummyGlobalInput>(memnew(DummyGlobalInput));
-                active_backend = BACKEND_DUMMY;
-            } 
-
+                return;
+            }
         #endif
 
         #ifdef __linux__
-            const char* wayland = std::getenv("WAYLAND_DISPLAY");
-            if (wayland) {
-                godot::print_line("Wayland detected, skipping global inputs for now.");
-                backend = Ref<DummyGlobalInput>(memnew(DummyGlobalInput));
-                active_backend = BACKEND_DUMMY;
+            if (name == "evdev") {
+                backend = Ref<LinuxGlobalInput>(memnew(LinuxGlobalInput));
+                active_backend = BACKEND_EVDEV;
                 return;
             }
-            else {
-                if (selected_backend == "x11") {
-                    backend = Ref<LinuxGlobalInput>(memnew(LinuxGlobalInput));
-                    active_backend = BACKEND_X11;
-                } 
-                else {
-                    backend = Ref<DummyGlobalInput>(memnew(DummyGlobalInput));
-                    active_backend = BACKEND_DUMMY;
-                } 
+        #endif
+
+        #if defined(__linux__) && defined(GI_USE_XINPUT2)
+            if (name == "xinput2") {
+                backend = Ref<XInput2GlobalInput>(memnew(XInput2GlobalInput));
+                active_backend = BACKEND_XINPUT2;
+                return;
             }
         #endif
 
+        backend = Ref<DummyGlobalInput>(memnew(DummyGlobalInput));
+        active_backend = BACKEND_DUMMY;
+    }
+
+    // Maps aliases and "auto" onto the backend to create. Auto probes whether
+    // devices can be opened rather than guessing from the display server.
+    String resolve_backend(const String &name) const {
+        if (name == "x11") return "evdev";
+        if (name != "auto") return name;
+
+        #ifdef _WIN32
+            return "windows";
+        #endif
+
+        #ifdef __linux__
+            if (!virtual_devices.is_empty() || LinuxInputHub::can_read_devices()) return "evdev";
+            if (XInput2InputHub::is_available()) return "xinput2";
+            godot::print_line("Global Input: No readable input devices, using the dummy backend. Is the user in the input group?");
+        #endif
+
+        return "dummy";
     }
 
 };
@@ -0,0 +1,220 @@
+#ifndef INPUT_HISTORY_H
+#define INPUT_HISTORY_H
+#pragma once
+
+#include "input_snapshot.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+using namespace godot;
+
+// Per-tick input of the last `capacity` ticks, for rollback: held keys, mouse
+// buttons, modifiers and pointer at any recorded tick.
+//
+// Keys are delta encoded. A tick stores the key bits that flipped since the
+// tick before it, and every KEYFRAME_INTERVAL ticks (or when a tick has more
+// than MAX_EDGES flips, or follows a gap) the whole bitmap goes into a keyframe
+// slot. A lookup starts at the tick's keyframe and replays fewer than
+// KEYFRAME_INTERVAL deltas, so it costs the same however long the history is.
+// Everything is allocated by set_capacity(), recording never allocates.
+// Main thread only.
+class InputHistory {
+public:
+    static constexpr uint32_t KEYFRAME_INTERVAL = 16;
+    static constexpr int MAX_EDGES = 8;
+
+    // Ticks to keep, 0 drops the history. Shorter than a keyframe interval is rounded up.
+    void set_capacity(int ticks) {
+        if (ticks < 0) ticks = 0;
+        if (ticks > 0 && ticks < (int)KEYFRAME_INTERVAL) ticks = KEYFRAME_INTERVAL;
+
+        // The oldest tick replays deltas from up to a keyframe interval before it,
+        // those entries are kept on top. Forced keyframes come on top of the regular
+        // ones, spare slots for them keep the oldest ticks readable unless nearly
+        // every tick forces one.
+        capacity = ticks;
+        entries.assign(ticks > 0 ? ticks + KEYFRAME_INTERVAL - 1 : 0, Entry());
+        keyframes.assign(ticks > 0 ? ticks / KEYFRAME_INTERVAL * 2 + 2 : 0, Keyframe());
+        next_keyframe = 0;
+        recorded = false;
+    }
+
+    int get_capacity() const { return capacity; }
+
+    void record(uint64_t tick, const InputSnapshot &snapshot) {
+        if (entries.empty()) return;
+        const PackedByteArray pressed = snapshot.get_pressed_keys();
+        const uint8_t *bits = pressed.ptr();
+
+        Entry &entry = entries[tick % entries.size()];
+        entry.tick = tick;
+        entry.mouse_buttons = (uint32_t)snapshot.get_mouse_buttons();
+        entry.modifiers = (uint32_t)snapshot.get_modifier_mask();
+        entry.wheel = snapshot.get_wheel_delta();
+        entry.mouse_position = snapshot.get_mouse_position();
+        entry.mouse_delta = snapshot.get_mouse_delta();
+
+        int edges = recorded ? diff(last_bits, bits, entry.edges) : MAX_EDGES + 1;
+        entry.edge_count = edges <= MAX_EDGES ? (uint8_t)edges : EDGES_UNKNOWN;
+
+        bool keyframe = !recorded || tick != last_tick + 1 || edges > MAX_EDGES || tick - keyframe_tick >= KEYFRAME_INTERVAL;
+        if (keyframe) {
+            keyframe_slot = next_keyframe++ % keyframes.size();
+            keyframes[keyframe_slot].tick = tick;
+            memcpy(keyframes[keyframe_slot].bits, bits, InputSnapshot::KEY_BYTES);
+            keyframe_tick = tick;
+        }
+        entry.keyframe_slot = keyframe_slot;
+        entry.keyframe_age = (uint8_t)(tick - keyframe_tick);
+
+        memcpy(last_bits, bits, InputSnapshot::KEY_BYTES);
+        last_tick = tick;
+        recorded = true;
+    }
+
+    bool has_tick(uint64_t tick) const {
+        const Entry *entry = find(tick);
+        return entry && keyframes[entry->keyframe_slot].tick == tick - entry->keyframe_age;
+    }
+
+    // -1 while nothing is recorded.
+    int64_t get_newest_tick() const { return recorded ? (int64_t)last_tick : -1; }
+
+    int64_t get_oldest_tick() const {
+        if (!recorded) return -1;
+        uint64_t span = (uint64_t)capacity - 1;
+        uint64_t oldest = last_tick > span ? last_tick - span : 0;
+        while (oldest < last_tick && !has_tick(oldest)) oldest++;
+        return (int64_t)oldest;
+    }
+
+    bool get_key_state(uint64_t tick, int key) const {
+        int bit = InputSnapshot::get_key_bit(key);
+        const Entry *entry = find(tick);
+        if (bit < 0 || !entry) return false;
+
+        const Keyframe &keyframe = keyframes[entry->keyframe_slot];
+        if (keyframe.tick != tick - entry->keyframe_age) return false;
+
+        bool pressed = (keyframe.bits[bit / 8] & (1 << (bit % 8))) != 0;
+        for (uint64_t t = keyframe.tick + 1; t <= tick; t++) {
+            const Entry &step = entries[t % entries.size()];
+            for (int i = 0; i < step.edge_count; i++) {
+                if (step.edges[i] == bit) pressed = !pressed;
+            }
+        }
+        return pressed;
+    }
+
+    // False if the tick is no longer (or never was) in the history.
+    bool get_snapshot(uint64_t tick, InputSnapshot &snapshot) const {
+        uint8_t bits[InputSnapshot::KEY_BYTES];
+        const Entry *entry = find(tick);
+        if (!entry || !key_bits(tick, *entry, bits)) return false;
+
+        snapshot.begin(tick);
+        for (int bit = 0; bit < InputSnapshot::KEY_BITS; bit++) {
+            if (bits[bit / 8] & (1 << (bit % 8))) snapshot.set_key_bit(bit, InputSnapshot::STATE_PRESSED);
+        }
+
+        // Just pressed and released are the tick's own flips, or for a keyframe
+        // with too many to store, the difference from the tick before.
+        uint8_t flipped[InputSnapshot::KEY_BYTES] = {};
+        const Entry *previous = tick > 0 ? find(tick - 1) : nullptr;
+        if (entry->edge_count != EDGES_UNKNOWN) {
+            for (int i = 0; i < entry->edge_count; i++) flipped[entry->edges[i] / 8] |= (uint8_t)(1 << (entry->edges[i] % 8));
+        } else if (previous && key_bits(tick - 1, *previous, flipped)) {
+            for (int byte = 0; byte < InputSnapshot::KEY_BYTES; byte++) flipped[byte] ^= bits[byte];
+        }
+        for (int bit = 0; bit < InputSnapshot::KEY_BITS; bit++) {
+            uint8_t mask = (uint8_t)(1 << (bit % 8));
+            if (!(flipped[bit / 8] & mask)) continue;
+            snapshot.set_key_bit(bit, (bits[bit / 8] & mask) ? InputSnapshot::STATE_JUST_PRESSED : InputSnapshot::STATE_JUST_RELEASED);
+        }
+
+        uint32_t buttons_before = previous ? previous->mouse_buttons : entry->mouse_buttons;
+        for (int button = 1; button <= 32; button++) {
+            uint32_t mask = 1u << (button - 1);
+            bool down = (entry->mouse_buttons & mask) != 0;
+            uint32_t states = down ? InputSnapshot::STATE_PRESSED : 0;
+            if ((buttons_before ^ entry->mouse_buttons) & mask) states |= down ? InputSnapshot::STATE_JUST_PRESSED : InputSnapshot::STATE_JUST_RELEASED;
+            if (states) snapshot.set_mouse_button(button, states);
+        }
+
+        snapshot.set_modifier_mask(entry->modifiers);
+        snapshot.set_pointer(entry->mouse_position, entry->mouse_delta, entry->wheel);
+        return true;
+    }
+
+private:
+    static constexpr uint8_t EDGES_UNKNOWN = 0xff;
+
+    struct Entry {
+        uint64_t tick = UINT64_MAX;
+        uint32_t keyframe_slot = 0;
+        uint32_t mouse_buttons = 0;
+        uint32_t modifiers = 0;
+        int32_t wheel = 0;
+        Vector2 mouse_position;
+        Vector2 mouse_delta;
+        uint8_t keyframe_age = 0; // ticks since the keyframe
+        uint8_t edge_count = 0;   // EDGES_UNKNOWN on keyframes with more flips
+        uint16_t edges[MAX_EDGES] = {};
+    };
+
+    struct Keyframe {
+        uint64_t tick = UINT64_MAX;
+        uint8_t bits[InputSnapshot::KEY_BYTES] = {};
+    };
+
+    int capacity = 0;
+    std::vector<Entry> entries;
+    std::vector<Keyframe> keyframes;
+    uint64_t next_keyframe = 0;
+
+    // Writer state.
+    bool recorded = false;
+    uint64_t last_tick = 0;
+    uint64_t keyframe_tick = 0;
+    uint32_t keyframe_slot = 0;
+    uint8_t last_bits[InputSnapshot::KEY_BYTES] = {};
+
+    const Entry *find(uint64_t tick) const {
+        if (entries.empty() || !recorded || tick > last_tick || last_tick - tick >= (uint64_t)capacity) return nullptr;
+        const Entry &entry = entries[tick % entries.size()];
+        return entry.tick == tick ? &entry : nullptr;
+    }
+
+    // The tick's full bitmap: its keyframe with the deltas after it applied. Only
+    // keyframes can overflow their edges, and those are never replayed.
+    bool key_bits(uint64_t tick, const Entry &entry, uint8_t *out) const {
+        const Keyframe &keyframe = keyframes[entry.keyframe_slot];
+        if (keyframe.tick != tick - entry.keyframe_age) return false;
+
+        memcpy(out, keyframe.bits, InputSnapshot::KEY_BYTES);
+        for (uint64_t t = keyframe.tick + 1; t <= tick; t++) {
+            const Entry &step = entries[t % entries.size()];
+            for (int i = 0; i < step.edge_count; i++) out[step.edges[i] / 8] ^= (uint8_t)(1 << (step.edges[i] % 8));
+        }
+        return true;
+    }
+
+    // Bits set in one bitmap but not the other, up to MAX_EDGES of them written
+    // to `edges`. Returns how many there are, so more than MAX_EDGES means overflow.
+    static int diff(const uint8_t *before, const uint8_t *after, uint16_t *edges) {
+        int count = 0;
+        for (int byte = 0; byte < InputSnapshot::KEY_BYTES; byte++) {
+            uint8_t changed = before[byte] ^ after[byte];
+            for (int bit = 0; changed; bit++, changed >>= 1) {
+                if (!(changed & 1)) continue;
+                if (count < MAX_EDGES) edges[count] = (uint16_t)(byte * 8 + bit);
+                count++;
+            }
+        }
+        return count;
+    }
+};
+
+#endif // INPUT_HISTORY_H
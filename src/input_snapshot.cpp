@@ -0,0 +1,110 @@
+#include "input_snapshot.h"
+
+#include "trackers/shared_state.h"
+
+#include <string.h>
+
+using namespace godot;
+
+static_assert(InputSnapshot::KEY_BITS == SHARED_STATE_KEY_BITS, "snapshot keys use the shared memory layout");
+
+InputSnapshot::InputSnapshot() {
+    pressed_keys.resize(KEY_BYTES);
+    just_pressed_keys.resize(KEY_BYTES);
+    just_released_keys.resize(KEY_BYTES);
+    begin(0);
+}
+
+void InputSnapshot::_bind_methods() {
+    ClassDB::bind_static_method("InputSnapshot", D_METHOD("get_key_bit", "key"), &InputSnapshot::get_key_bit);
+    ClassDB::bind_method(D_METHOD("get_frame"), &InputSnapshot::get_frame);
+
+    ClassDB::bind_method(D_METHOD("is_key_pressed", "key"), &InputSnapshot::is_key_pressed);
+    ClassDB::bind_method(D_METHOD("is_key_just_pressed", "key"), &InputSnapshot::is_key_just_pressed);
+    ClassDB::bind_method(D_METHOD("is_key_just_released", "key"), &InputSnapshot::is_key_just_released);
+    ClassDB::bind_method(D_METHOD("get_pressed_keys"), &InputSnapshot::get_pressed_keys);
+    ClassDB::bind_method(D_METHOD("get_just_pressed_keys"), &InputSnapshot::get_just_pressed_keys);
+    ClassDB::bind_method(D_METHOD("get_just_released_keys"), &InputSnapshot::get_just_released_keys);
+
+    ClassDB::bind_method(D_METHOD("is_mouse_pressed", "button"), &InputSnapshot::is_mouse_pressed);
+    ClassDB::bind_method(D_METHOD("is_mouse_just_pressed", "button"), &InputSnapshot::is_mouse_just_pressed);
+    ClassDB::bind_method(D_METHOD("is_mouse_just_released", "button"), &InputSnapshot::is_mouse_just_released);
+    ClassDB::bind_method(D_METHOD("get_mouse_buttons"), &InputSnapshot::get_mouse_buttons);
+
+    ClassDB::bind_method(D_METHOD("get_modifier_mask"), &InputSnapshot::get_modifier_mask);
+    ClassDB::bind_method(D_METHOD("is_modifier_pressed", "modifiers"), &InputSnapshot::is_modifier_pressed);
+
+    ClassDB::bind_method(D_METHOD("get_mouse_position"), &InputSnapshot::get_mouse_position);
+    ClassDB::bind_method(D_METHOD("get_mouse_delta"), &InputSnapshot::get_mouse_delta);
+    ClassDB::bind_method(D_METHOD("get_wheel_delta"), &InputSnapshot::get_wheel_delta);
+
+    ClassDB::bind_method(D_METHOD("is_action_pressed", "action"), &InputSnapshot::is_action_pressed);
+    ClassDB::bind_method(D_METHOD("is_action_just_pressed", "action"), &InputSnapshot::is_action_just_pressed);
+    ClassDB::bind_method(D_METHOD("is_action_just_released", "action"), &InputSnapshot::is_action_just_released);
+    ClassDB::bind_method(D_METHOD("get_actions"), &InputSnapshot::get_actions);
+}
+
+int InputSnapshot::get_key_bit(int key) {
+    return SharedStatePublisher::key_bit(key);
+}
+
+// Writing through ptrw() only copies a bitmap a script still holds from an earlier frame.
+void InputSnapshot::begin(uint64_t p_frame) {
+    frame = p_frame;
+    memset(pressed_keys.ptrw(), 0, KEY_BYTES);
+    memset(just_pressed_keys.ptrw(), 0, KEY_BYTES);
+    memset(just_released_keys.ptrw(), 0, KEY_BYTES);
+
+    mouse_pressed = mouse_just_pressed = mouse_just_released = 0;
+    modifier_mask = 0;
+    mouse_position = Vector2();
+    mouse_delta = Vector2();
+    wheel_delta = 0;
+    if (action_states.size() > 0) memset(action_states.ptrw(), 0, action_states.size());
+}
+
+void InputSnapshot::set_key(int key, uint32_t states) {
+    set_key_bit(get_key_bit(key), states);
+}
+
+void InputSnapshot::set_key_bit(int bit, uint32_t states) {
+    if (bit < 0 || bit >= KEY_BITS) return;
+    uint8_t mask = (uint8_t)(1 << (bit % 8));
+    if (states & STATE_PRESSED) pressed_keys.ptrw()[bit / 8] |= mask;
+    if (states & STATE_JUST_PRESSED) just_pressed_keys.ptrw()[bit / 8] |= mask;
+    if (states & STATE_JUST_RELEASED) just_released_keys.ptrw()[bit / 8] |= mask;
+}
+
+void InputSnapshot::set_mouse_button(int button, uint32_t states) {
+    uint32_t bit = button_bit(button);
+    if (states & STATE_PRESSED) mouse_pressed |= bit;
+    if (states & STATE_JUST_PRESSED) mouse_just_pressed |= bit;
+    if (states & STATE_JUST_RELEASED) mouse_just_released |= bit;
+}
+
+void InputSnapshot::set_pointer(const Vector2 &position, const Vector2 &delta, int wheel) {
+    mouse_position = position;
+    mouse_delta = delta;
+    wheel_delta = wheel;
+}
+
+void InputSnapshot::set_actions(const PackedStringArray &p_actions) {
+    if (p_actions == actions) return;
+
+    actions = p_actions;
+    action_index.clear();
+    for (int64_t i = 0; i < actions.size(); i++) action_index[actions[i]] = i;
+    action_states.resize(actions.size());
+    if (action_states.size() > 0) memset(action_states.ptrw(), 0, action_states.size());
+}
+
+void InputSnapshot::set_action_state(int index, uint32_t states) {
+    if (index < 0 || index >= action_states.size()) return;
+    action_states.ptrw()[index] = (uint8_t)states;
+}
+
+uint32_t InputSnapshot::action_state(const String &action) const {
+    Variant index = action_index.get(action, -1);
+    int i = (int)index;
+    return i >= 0 && i < action_states.size() ? action_states[i] : 0;
+}
@@ -0,0 +1,116 @@
+#ifndef INPUT_SNAPSHOT_H
+#define INPUT_SNAPSHOT_H
+#pragma once
+
+#include "godot_cpp/classes/ref_counted.hpp"
+#include "godot_cpp/core/class_db.hpp"
+#include "godot_cpp/variant/dictionary.hpp"
+#include "godot_cpp/variant/packed_byte_array.hpp"
+#include "godot_cpp/variant/packed_string_array.hpp"
+#include "godot_cpp/variant/vector2.hpp"
+
+#include <stdint.h>
+
+using namespace godot;
+
+// Input state of one frame, filled by the backend under a single lock so every
+// field describes the same instant. GlobalInput refills the same object each
+// frame, and reading it takes no locks.
+//
+// Keys are bitmaps with the shared memory layout: bit n is the Godot key n for
+// n < 256 and KEY_SPECIAL + (n - 256) above (get_key_bit() maps a key). Mouse
+// buttons are bit (MouseButton - 1) of an int.
+class InputSnapshot : public RefCounted {
+    GDCLASS(InputSnapshot, RefCounted);
+
+protected:
+    static void _bind_methods();
+
+public:
+    static constexpr int KEY_BITS = 512;
+    static constexpr int KEY_BYTES = KEY_BITS / 8;
+
+    enum State : uint32_t {
+        STATE_PRESSED = 1 << 0,
+        STATE_JUST_PRESSED = 1 << 1,
+        STATE_JUST_RELEASED = 1 << 2,
+    };
+
+    InputSnapshot();
+
+    static int get_key_bit(int key);
+
+    int64_t get_frame() const { return (int64_t)frame; }
+
+    bool is_key_pressed(int key) const { return test(pressed_keys, key); }
+    bool is_key_just_pressed(int key) const { return test(just_pressed_keys, key); }
+    bool is_key_just_released(int key) const { return test(just_released_keys, key); }
+    PackedByteArray get_pressed_keys() const { return pressed_keys; }
+    PackedByteArray get_just_pressed_keys() const { return just_pressed_keys; }
+    PackedByteArray get_just_released_keys() const { return just_released_keys; }
+
+    bool is_mouse_pressed(int button) const { return (mouse_pressed & button_bit(button)) != 0; }
+    bool is_mouse_just_pressed(int button) const { return (mouse_just_pressed & button_bit(button)) != 0; }
+    bool is_mouse_just_released(int button) const { return (mouse_just_released & button_bit(button)) != 0; }
+    int64_t get_mouse_buttons() const { return mouse_pressed; }
+
+    int64_t get_modifier_mask() const { return modifier_mask; }
+    bool is_modifier_pressed(int64_t modifiers) const { return (modifier_mask & (uint32_t)modifiers) != 0; }
+
+    Vector2 get_mouse_position() const { return mouse_position; }
+    Vector2 get_mouse_delta() const { return mouse_delta; }
+    int get_wheel_delta() const { return wheel_delta; }
+
+    // Actions not in get_actions() read as released.
+    bool is_action_pressed(const String &action) const { return (action_state(action) & STATE_PRESSED) != 0; }
+    bool is_action_just_pressed(const String &action) const { return (action_state(action) & STATE_JUST_PRESSED) != 0; }
+    bool is_action_just_released(const String &action) const { return (action_state(action) & STATE_JUST_RELEASED) != 0; }
+    PackedStringArray get_actions() const { return actions; }
+
+    // Filling, for backends. begin() clears everything but the action list.
+
+    void begin(uint64_t p_frame);
+    void set_key(int key, uint32_t states);
+    void set_key_bit(int bit, uint32_t states);
+    void set_mouse_button(int button, uint32_t states);
+    void set_modifier_mask(uint32_t mask) { modifier_mask = mask; }
+    void set_pointer(const Vector2 &position, const Vector2 &delta, int wheel);
+
+    // The index is only rebuilt when the list changes.
+    void set_actions(const PackedStringArray &p_actions);
+    void set_action_state(int index, uint32_t states);
+    uint32_t get_action_state(int index) const { return index >= 0 && index < action_states.size() ? action_states[index] : 0; }
+
+private:
+    uint64_t frame = 0;
+
+    PackedByteArray pressed_keys;
+    PackedByteArray just_pressed_keys;
+    PackedByteArray just_released_keys;
+
+    uint32_t mouse_pressed = 0;
+    uint32_t mouse_just_pressed = 0;
+    uint32_t mouse_just_released = 0;
+    uint32_t modifier_mask = 0;
+
+    Vector2 mouse_position;
+    Vector2 mouse_delta;
+    int wheel_delta = 0;
+
+    PackedStringArray actions;
+    PackedByteArray action_states;
+    Dictionary action_index; // action name -> index in actions
+
+    static bool test(const PackedByteArray &bits, int key) {
+        int bit = get_key_bit(key);
+        return bit >= 0 && (bits[bit / 8] & (1 << (bit % 8))) != 0;
+    }
+
+    static uint32_t button_bit(int button) {
+        return button >= 1 && button <= 32 ? 1u << (button - 1) : 0;
+    }
+
+    uint32_t action_state(const String &action) const;
+};
+
+#endif // INPUT_SNAPSHOT_H
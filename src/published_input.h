@@ -0,0 +1,157 @@
+#ifndef PUBLISHED_INPUT_H
+#define PUBLISHED_INPUT_H
+#pragma once
+
+#include "input_snapshot.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+
+using namespace godot;
+
+// The frame's InputSnapshot, published for other threads behind a seqlock.
+// The main thread writes it once per frame; readers only load the sequence
+// and copy plain values, so any number of them run at once without taking a
+// lock or touching the hub's maps, and retry if a write overlapped the read.
+class PublishedInput {
+public:
+    static constexpr int MAX_ACTIONS = 256;
+
+    // Main thread only.
+    void publish(const InputSnapshot &snapshot) {
+        const PackedByteArray keys[3] = {
+            snapshot.get_pressed_keys(), snapshot.get_just_pressed_keys(), snapshot.get_just_released_keys()
+        };
+        const PackedStringArray actions = snapshot.get_actions();
+        bool actions_changed = !(actions == published_actions);
+
+        begin_write();
+        state.frame = (uint64_t)snapshot.get_frame();
+        for (int i = 0; i < 3; i++) memcpy(state.keys[i], keys[i].ptr(), InputSnapshot::KEY_BYTES);
+
+        for (int button = 1; button <= 32; button++) {
+            uint32_t bit = 1u << (button - 1);
+            set_bit(state.mouse[0], bit, snapshot.is_mouse_pressed(button));
+            set_bit(state.mouse[1], bit, snapshot.is_mouse_just_pressed(button));
+            set_bit(state.mouse[2], bit, snapshot.is_mouse_just_released(button));
+        }
+        state.modifiers = (uint32_t)snapshot.get_modifier_mask();
+        state.mouse_position = snapshot.get_mouse_position();
+        state.mouse_delta = snapshot.get_mouse_delta();
+        state.wheel = snapshot.get_wheel_delta();
+
+        // Actions past MAX_ACTIONS aren't published and read as released.
+        int count = actions.size() < MAX_ACTIONS ? (int)actions.size() : MAX_ACTIONS;
+        if (actions_changed) {
+            for (int i = 0; i < count; i++) state.action_hash[i] = hash_name(actions[i]);
+            state.action_count = count;
+        }
+        for (int i = 0; i < count; i++) state.action_states[i] = (uint8_t)snapshot.get_action_state(i);
+        end_write();
+
+        if (actions_changed) published_actions = actions;
+    }
+
+    // Any thread.
+
+    int64_t get_frame() const { return (int64_t)read([](const State &s) { return s.frame; }); }
+
+    bool test_key(InputSnapshot::State which, int key) const {
+        int bit = InputSnapshot::get_key_bit(key);
+        if (bit < 0) return false;
+        int index = state_index(which);
+        return read([&](const State &s) { return (s.keys[index][bit / 8] & (1 << (bit % 8))) != 0; });
+    }
+
+    bool test_mouse(InputSnapshot::State which, int button) const {
+        if (button < 1 || button > 32) return false;
+        int index = state_index(which);
+        return read([&](const State &s) { return (s.mouse[index] & (1u << (button - 1))) != 0; });
+    }
+
+    uint32_t get_modifier_mask() const { return read([](const State &s) { return s.modifiers; }); }
+    Vector2 get_mouse_position() const { return read([](const State &s) { return s.mouse_position; }); }
+    Vector2 get_mouse_delta() const { return read([](const State &s) { return s.mouse_delta; }); }
+
+    // Hashed outside the read so a retry only repeats the scan.
+    bool test_action(InputSnapshot::State which, const String &action) const {
+        uint64_t hash = hash_name(action);
+        return read([&](const State &s) {
+            for (uint32_t i = 0; i < s.action_count && i < MAX_ACTIONS; i++) {
+                if (s.action_hash[i] == hash) return (s.action_states[i] & which) != 0;
+            }
+            return false;
+        });
+    }
+
+private:
+    struct State {
+        uint64_t frame = 0;
+        uint8_t keys[3][InputSnapshot::KEY_BYTES] = {};
+        uint32_t mouse[3] = {};
+        uint32_t modifiers = 0;
+        Vector2 mouse_position;
+        Vector2 mouse_delta;
+        int wheel = 0;
+
+        uint32_t action_count = 0;
+        uint64_t action_hash[MAX_ACTIONS] = {};
+        uint8_t action_states[MAX_ACTIONS] = {};
+    };
+
+    std::atomic<uint64_t> sequence{0};
+    State state;
+    PackedStringArray published_actions; // main thread only
+
+    void begin_write() {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void end_write() {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Runs `f` until it saw no write in progress and none finished meanwhile.
+    template <typename F>
+    auto read(F f) const -> decltype(f(state)) {
+        for (;;) {
+            uint64_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            auto result = f(state);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) return result;
+        }
+    }
+
+    static int state_index(InputSnapshot::State which) {
+        switch (which) {
+            case InputSnapshot::STATE_JUST_PRESSED: return 1;
+            case InputSnapshot::STATE_JUST_RELEASED: return 2;
+            default: return 0;
+        }
+    }
+
+    // 64-bit FNV-1a of the UTF-8 name. Storing hashes keeps the state plain
+    // data; a collision among a few hundred names is vanishingly unlikely.
+    static uint64_t hash_name(const String &name) {
+        const CharString utf8 = name.utf8();
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (const char *c = utf8.get_data(); *c; c++) {
+            hash = (hash ^ (uint8_t)*c) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    static void set_bit(uint32_t &bits, uint32_t mask, bool on) {
+        if (on) bits |= mask;
+        else bits &= ~mask;
+    }
+};
+
+#endif // PUBLISHED_INPUT_H
@@ -14,6 +14,7 @@ void initialize_gdextension_types(ModuleInitializationLevel p_level)
 	if (p_level != MODULE_INITIALIZATION_LEVEL_SCENE) {
 		return;
 	}
+	GDREGISTER_CLASS(InputSnapshot);
 	GDREGISTER_CLASS(GlobalInput);
 }
 
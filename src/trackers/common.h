@@ -11,6 +11,9 @@
 #include <godot_cpp/classes/os.hpp>
 #include "godot_cpp/classes/display_server.hpp"
 #include <godot_cpp/variant/vector2.hpp>
+#include <godot_cpp/variant/rect2.hpp>
+#include <godot_cpp/variant/packed_vector2_array.hpp>
+#include <godot_cpp/variant/packed_int32_array.hpp>
 #include <godot_cpp/variant/dictionary.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 #include <godot_cpp/classes/object.hpp>
@@ -18,6 +21,8 @@
 #include <thread>
 
 #include "keymaps.h"
+#include "hook_thread.h"
+#include "../input_snapshot.h"
 
 using namespace godot;
 
@@ -39,6 +44,69 @@ public:
     virtual bool is_mouse_just_pressed(int button) = 0;
     virtual bool is_mouse_just_released(int button) = 0;
 
+    // Keys by position rather than by what the layout makes them. Physical keys use
+    // Godot's physical keycodes, scancodes the backend's raw codes (evdev on Linux).
+    virtual bool is_physical_key_pressed(int key) { return is_key_pressed(key); }
+    virtual bool is_scancode_pressed(int code) { return false; }
+
+    // Key repeat. Echo means the OS repeated the held key during the last frame.
+    virtual bool is_key_echo(int key) { return false; }
+    virtual int get_key_repeat_count(int key) { return 0; }
+    // True on the press and on every synthesized repeat, `delay_msec` after the
+    // press and then `rate` times per second, whatever the OS repeat settings.
+    virtual bool is_action_repeating(const String &action, int delay_msec, float rate) { return false; }
+
+    // Switch chatter filtering. Eager applies an edge at once and ignores the key
+    // for the window after it, deferred waits until the key was stable that long.
+    enum DebounceMode {
+        DEBOUNCE_EAGER,
+        DEBOUNCE_DEFERRED,
+    };
+
+    virtual void set_debounce(int mode, int msec) {}
+    virtual void set_key_debounce(int key, int msec) {}
+    virtual int64_t get_debounce_suppressed() { return 0; }
+
+    // Keys this node needs decoded, empty for all of them. The hook decodes what any node needs.
+    virtual void set_tracked_keys(const PackedInt32Array &keys) {}
+
+    // Whether the last press happened within `msec`, timed by the source's event
+    // timestamps where it has them, so the window doesn't depend on frame rate.
+    virtual bool is_key_pressed_within(int key, int msec) { return false; }
+    virtual bool is_mouse_pressed_within(int button, int msec) { return false; }
+    virtual bool is_action_buffered(const String &action, int msec) { return false; }
+
+    virtual void set_thread_config(const HookThreadConfig &config) {}
+    virtual String get_thread_config_error() { return String(); }
+
+    virtual void set_shared_memory_name(const String &name) {}
+    virtual void set_event_stream_path(const String &path) {}
+    virtual int64_t get_event_stream_dropped() { return 0; }
+
+    virtual void set_power_saving(bool enabled) {}
+    virtual double get_hook_wakeups_per_second() { return 0.0; }
+
+    // Coalesced keeps one motion update per report and frame, path also keeps
+    // every report's cursor position for get_mouse_path().
+    enum MotionMode {
+        MOTION_COALESCED,
+        MOTION_PATH,
+    };
+
+    virtual void set_motion_mode(int mode) {}
+    virtual PackedVector2Array get_mouse_path() { return PackedVector2Array(); }
+
+    virtual Vector2 get_mouse_delta() { return Vector2(); }
+    virtual Vector2 get_mouse_velocity() { return Vector2(); }
+    virtual Vector2 get_mouse_acceleration() { return Vector2(); }
+
+    virtual float get_pen_pressure() { return 0.0f; }
+    virtual Vector2 get_pen_tilt() { return Vector2(); }
+
+    virtual bool is_joy_button_pressed(int device, int button) { return false; }
+    virtual float get_joy_axis(int device, int axis) { return 0.0f; }
+    virtual void set_joy_deadzone(float deadzone) {}
+
     virtual bool is_action_pressed(const String &action) = 0;
     virtual bool is_action_just_pressed(const String &action) = 0;
     virtual bool is_action_just_released(const String &action) = 0;
@@ -55,90 +123,133 @@ public:
     virtual void poll_data() = 0;
     virtual void handle_input(const Ref<InputEvent> &event) = 0;
 
-    bool modifiers_match(InputEvent *key_ev){
-        bool ev_shift = false;
-        bool ev_ctrl  = false;
-        bool ev_alt   = false;
-        bool ev_meta  = false;
-        int  ev_keycode = 0;
-
-        if (InputEventKey *key_ev = Object::cast_to<InputEventKey>(key_ev)) {
-            ev_shift   = key_ev->is_shift_pressed();
-            ev_ctrl    = key_ev->is_ctrl_pressed();
-            ev_alt     = key_ev->is_alt_pressed();
-            ev_meta    = key_ev->is_meta_pressed();
-            ev_keycode = key_ev->get_keycode();
-        } else if (InputEventMouseButton *mouse_ev = Object::cast_to<InputEventMouseButton>(key_ev)) {
-            ev_shift = mouse_ev->is_shift_pressed();
-            ev_ctrl  = mouse_ev->is_ctrl_pressed();
-            ev_alt   = mouse_ev->is_alt_pressed();
-            ev_meta  = mouse_ev->is_meta_pressed();
-        } else {
-            return true;
+    // Fills `snapshot` with the frame's state for the actions it lists. This asks
+    // the query methods one by one; backends with state of their own read it under
+    // one lock instead, so nothing changes halfway through.
+    virtual void capture_snapshot(InputSnapshot &snapshot) {
+        snapshot.begin(current_frame);
+        snapshot.set_modifier_mask(get_modifier_mask());
+        snapshot.set_pointer(get_mouse_position(), get_mouse_delta(), 0);
+        for (int button = MOUSE_BUTTON_LEFT; button <= MOUSE_BUTTON_XBUTTON2; button++) {
+            snapshot.set_mouse_button(button, snapshot_states(is_mouse_pressed(button), is_mouse_just_pressed(button), is_mouse_just_released(button)));
         }
 
-        bool shift_now = is_shift_pressed();
-        bool ctrl_now  = is_ctrl_pressed();
-        bool alt_now   = is_alt_pressed();
-        bool meta_now  = is_meta_pressed();
-
-        if (ev_keycode == KEY_SHIFT || ev_keycode == KEY_CTRL || ev_keycode == KEY_ALT || ev_keycode == KEY_META) {
-            if (ev_keycode == KEY_SHIFT) ev_shift = shift_now;
-            if (ev_keycode == KEY_CTRL)  ev_ctrl  = ctrl_now;
-            if (ev_keycode == KEY_ALT)   ev_alt   = alt_now;
-            if (ev_keycode == KEY_META)  ev_meta  = meta_now;
+        const PackedStringArray actions = snapshot.get_actions();
+        for (int i = 0; i < (int)actions.size(); i++) {
+            const String &action = actions[i];
+            snapshot.set_action_state(i, snapshot_states(is_action_pressed(action), is_action_just_pressed(action), is_action_just_released(action)));
         }
-
-        if (ev_shift != shift_now) return false;
-        if (ev_ctrl  != ctrl_now)  return false;
-        if (ev_alt   != alt_now)   return false;
-        if (ev_meta  != meta_now)  return false;
-
-        return true;
     }
 
+    static uint32_t snapshot_states(bool pressed, bool just_pressed, bool just_released) {
+        return (pressed ? InputSnapshot::STATE_PRESSED : 0)
+            | (just_pressed ? InputSnapshot::STATE_JUST_PRESSED : 0)
+            | (just_released ? InputSnapshot::STATE_JUST_RELEASED : 0);
+    }
 
-    KeyMaps* key_maps = new KeyMaps();
-
-    static std::unordered_map<int, bool> key_state;
-    static std::unordered_map<int, uint64_t> key_just_pressed_frame;
-    static std::unordered_map<int, uint64_t> key_just_released_frame;
+    // Empty layout means "use the system layout". Only backends that translate raw scancodes care.
+    virtual void set_keyboard_layout(const String &layout, const String &variant) {}
+
+    virtual Array get_devices() { return Array(); }
+
+    // Reads a FIFO, socket or file of raw input_event records as a device of `role`.
+    virtual bool add_virtual_device(const String &path, const String &role, const String &name) { return false; }
+
+    // Async starts report readiness here instead of blocking start().
+    virtual bool is_hook_ready() { return true; }
+    virtual bool is_hook_failed() { return false; }
+
+    // One bit per physical modifier key. The unsided values cover both keys.
+    enum Modifier : uint32_t {
+        MODIFIER_LEFT_SHIFT = 1 << 0,
+        MODIFIER_RIGHT_SHIFT = 1 << 1,
+        MODIFIER_LEFT_CTRL = 1 << 2,
+        MODIFIER_RIGHT_CTRL = 1 << 3,
+        MODIFIER_LEFT_ALT = 1 << 4,
+        MODIFIER_RIGHT_ALT = 1 << 5,
+        MODIFIER_LEFT_META = 1 << 6,
+        MODIFIER_RIGHT_META = 1 << 7,
+
+        MODIFIER_SHIFT = MODIFIER_LEFT_SHIFT | MODIFIER_RIGHT_SHIFT,
+        MODIFIER_CTRL = MODIFIER_LEFT_CTRL | MODIFIER_RIGHT_CTRL,
+        MODIFIER_ALT = MODIFIER_LEFT_ALT | MODIFIER_RIGHT_ALT,
+        MODIFIER_META = MODIFIER_LEFT_META | MODIFIER_RIGHT_META,
+    };
+
+    // Backends that can't tell the sides apart report the left key.
+    virtual uint32_t get_modifier_mask() {
+        uint32_t mask = 0;
+        if (is_shift_pressed()) mask |= MODIFIER_LEFT_SHIFT;
+        if (is_ctrl_pressed()) mask |= MODIFIER_LEFT_CTRL;
+        if (is_alt_pressed()) mask |= MODIFIER_LEFT_ALT;
+        if (is_meta_pressed()) mask |= MODIFIER_LEFT_META;
+        return mask;
+    }
 
-    static std::unordered_map<int, bool> mouse_state;
-    static std::unordered_map<int, uint64_t> mouse_just_pressed_frame;
-    static std::unordered_map<int, uint64_t> mouse_just_released_frame;
+    // Both sides of the modifier `bit` belongs to.
+    static uint32_t modifier_group(uint32_t bit) {
+        if (bit & MODIFIER_SHIFT) return MODIFIER_SHIFT;
+        if (bit & MODIFIER_CTRL) return MODIFIER_CTRL;
+        if (bit & MODIFIER_ALT) return MODIFIER_ALT;
+        if (bit & MODIFIER_META) return MODIFIER_META;
+        return 0;
+    }
 
-    static std::unordered_map<int, bool> joy_state;
-    static std::unordered_map<int, uint64_t> joy_just_pressed_frame;
-    static std::unordered_map<int, uint64_t> joy_just_released_frame;
+    // The Godot key for either side of a modifier, 0 for other keys.
+    static int modifier_key(uint32_t bit) {
+        switch (modifier_group(bit)) {
+            case MODIFIER_SHIFT: return KEY_SHIFT;
+            case MODIFIER_CTRL: return KEY_CTRL;
+            case MODIFIER_ALT: return KEY_ALT;
+            case MODIFIER_META: return KEY_META;
+            default: return 0;
+        }
+    }
 
-    static Vector2 mouse_position;
-    static int wheel_delta;
-    static uint64_t current_frame;
+    static uint32_t modifier_for_key(int key) {
+        switch (key) {
+            case KEY_SHIFT: return MODIFIER_SHIFT;
+            case KEY_CTRL: return MODIFIER_CTRL;
+            case KEY_ALT: return MODIFIER_ALT;
+            case KEY_META: return MODIFIER_META;
+            default: return 0;
+        }
+    }
 
-    static std::atomic<bool> running;
-    static std::thread hook_thread;
-    std::recursive_mutex state_mutex;
+    // Compares which modifier groups the binding wants with the held ones in one
+    // go. A binding for a modifier key doesn't also require that modifier.
+    bool modifiers_match(InputEvent *ev){
+        uint32_t wanted = 0;
+        uint32_t ignored = 0;
+
+        if (InputEventKey *key_ev = Object::cast_to<InputEventKey>(ev)) {
+            if (key_ev->is_shift_pressed()) wanted |= MODIFIER_SHIFT;
+            if (key_ev->is_ctrl_pressed()) wanted |= MODIFIER_CTRL;
+            if (key_ev->is_alt_pressed()) wanted |= MODIFIER_ALT;
+            if (key_ev->is_meta_pressed()) wanted |= MODIFIER_META;
+            ignored = modifier_for_key(key_ev->get_keycode());
+        } else if (InputEventMouseButton *mouse_ev = Object::cast_to<InputEventMouseButton>(ev)) {
+            if (mouse_ev->is_shift_pressed()) wanted |= MODIFIER_SHIFT;
+            if (mouse_ev->is_ctrl_pressed()) wanted |= MODIFIER_CTRL;
+            if (mouse_ev->is_alt_pressed()) wanted |= MODIFIER_ALT;
+            if (mouse_ev->is_meta_pressed()) wanted |= MODIFIER_META;
+        } else {
+            return true;
+        }
 
-    std::unordered_map<int, int> key_map;
+        return (wanted & ~ignored) == (held_groups(get_modifier_mask()) & ~ignored);
+    }
 
+    // Sets both bits of every group with at least one side held. Relies on each
+    // group being a left/right pair starting at an even bit.
+    static uint32_t held_groups(uint32_t mask) {
+        uint32_t sides = (mask | (mask >> 1)) & 0x55;
+        return sides | (sides << 1);
+    }
 
+    uint64_t current_frame = 0;
+    bool async_start = false;
 };
 static constexpr uint64_t JUST_BUFFER_FRAMES = 1;
 
-inline std::unordered_map<int, bool> GlobalInputCommon::key_state;
-inline std::unordered_map<int, uint64_t> GlobalInputCommon::key_just_pressed_frame;
-inline std::unordered_map<int, uint64_t> GlobalInputCommon::key_just_released_frame;
-
-inline std::unordered_map<int, bool> GlobalInputCommon::mouse_state;
-inline std::unordered_map<int, uint64_t> GlobalInputCommon::mouse_just_pressed_frame;
-inline std::unordered_map<int, uint64_t> GlobalInputCommon::mouse_just_released_frame;
-
-inline int GlobalInputCommon::wheel_delta = 0;
-inline Vector2 GlobalInputCommon::mouse_position;
-inline uint64_t GlobalInputCommon::current_frame = 0;
-inline std::atomic<bool> GlobalInputCommon::running = false;
-inline std::thread GlobalInputCommon::hook_thread;
-
-
 #endif
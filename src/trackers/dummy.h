@@ -23,6 +23,8 @@ public:
         key_state.clear();
         key_just_pressed_frame.clear();
         key_just_released_frame.clear();
+        key_echo_frame.clear();
+        key_repeat_count.clear();
 
         mouse_state.clear();
         mouse_just_pressed_frame.clear();
@@ -69,6 +71,17 @@ public:
             (current_frame - it->second) <= JUST_BUFFER_FRAMES;
     }
 
+    bool is_key_echo(int key) override{
+        auto it = key_echo_frame.find(key);
+        return is_key_pressed(key) &&
+            it != key_echo_frame.end() &&
+            (current_frame - it->second) <= JUST_BUFFER_FRAMES;
+    }
+
+    int get_key_repeat_count(int key) override{
+        return is_key_pressed(key) ? (int)key_repeat_count[key] : 0;
+    }
+
     // Mouse Input
 
     bool is_mouse_pressed(int button) override{
@@ -96,6 +109,16 @@ public:
         return DisplayServer::get_singleton()->mouse_get_position();
     }
 
+    bool is_joy_button_pressed(int device, int button) override{
+        if (!Input::get_singleton()) return false;
+        return Input::get_singleton()->is_joy_button_pressed(device, (JoyButton)button);
+    }
+
+    float get_joy_axis(int device, int axis) override{
+        if (!Input::get_singleton()) return 0.0f;
+        return Input::get_singleton()->get_joy_axis(device, (JoyAxis)axis);
+    }
+
     // Godot InputMap Action Detection
 
     bool is_action_pressed(const String &action) override{
@@ -138,7 +161,7 @@ public:
     Dictionary get_keys_just_pressed_detailed() override{
         Dictionary dict;
         for (const auto &[key, frame] : key_just_pressed_frame) {
-            if ((current_frame - frame) > 1) continue;
+            if ((current_frame - frame) > JUST_BUFFER_FRAMES) continue;
             String name = "Unknown";
             if (OS::get_singleton() && key >= 0 && key <= KEY_MENU)
                 name = OS::get_singleton()->get_keycode_string((Key)key);
@@ -153,7 +176,7 @@ public:
     Dictionary get_keys_just_released_detailed() override{
         Dictionary dict;
         for (const auto &[key, frame] : key_just_released_frame) {
-            if ((current_frame - frame) > 1) continue;
+            if ((current_frame - frame) > JUST_BUFFER_FRAMES) continue;
             String name = "Unknown";
             if (OS::get_singleton() && key >= 0 && key <= KEY_MENU)
                 name = OS::get_singleton()->get_keycode_string((Key)key);
@@ -164,6 +187,20 @@ public:
         return dict;
     }
 
+    // Keys come from the events handle_input() saw, the rest from the defaults.
+    void capture_snapshot(InputSnapshot &snapshot) override {
+        GlobalInputCommon::capture_snapshot(snapshot);
+        for (const auto &[key, down] : key_state) {
+            if (down) snapshot.set_key(key, InputSnapshot::STATE_PRESSED);
+        }
+        for (const auto &[key, frame] : key_just_pressed_frame) {
+            if (frame != 0 && (current_frame - frame) <= JUST_BUFFER_FRAMES) snapshot.set_key(key, InputSnapshot::STATE_JUST_PRESSED);
+        }
+        for (const auto &[key, frame] : key_just_released_frame) {
+            if (frame != 0 && (current_frame - frame) <= JUST_BUFFER_FRAMES) snapshot.set_key(key, InputSnapshot::STATE_JUST_RELEASED);
+        }
+    }
+
     // Modifiers
 
     bool is_shift_pressed() {return Input::get_singleton()->is_key_pressed(KEY_SHIFT);}
@@ -174,20 +211,20 @@ public:
 
     bool is_meta_pressed() { return Input::get_singleton()->is_key_pressed(KEY_META);}
 
-    bool modifiers_match(InputEvent *key_ev){
+    bool modifiers_match(InputEvent *ev){
         bool ev_shift = false;
         bool ev_ctrl  = false;
         bool ev_alt   = false;
         bool ev_meta  = false;
         int  ev_keycode = 0;
 
-        if (InputEventKey *key_ev = Object::cast_to<InputEventKey>(key_ev)) {
+        if (InputEventKey *key_ev = Object::cast_to<InputEventKey>(ev)) {
             ev_shift   = key_ev->is_shift_pressed();
             ev_ctrl    = key_ev->is_ctrl_pressed();
             ev_alt     = key_ev->is_alt_pressed();
             ev_meta    = key_ev->is_meta_pressed();
             ev_keycode = key_ev->get_keycode();
-        } else if (InputEventMouseButton *mouse_ev = Object::cast_to<InputEventMouseButton>(key_ev)) {
+        } else if (InputEventMouseButton *mouse_ev = Object::cast_to<InputEventMouseButton>(ev)) {
             ev_shift = mouse_ev->is_shift_pressed();
             ev_ctrl  = mouse_ev->is_ctrl_pressed();
             ev_alt   = mouse_ev->is_alt_pressed();
@@ -228,7 +265,11 @@ public:
         if (key->is_pressed() && !key->is_echo()) {
             key_state[code] = true;
             key_just_pressed_frame[code] = current_frame;
-        } else if (!key->is_pressed()) {
+            key_repeat_count[code] = 0;
+        } else if (key->is_pressed()) {
+            key_echo_frame[code] = current_frame;
+            key_repeat_count[code]++;
+        } else {
             key_state[code] = false;
             key_just_released_frame[code] = current_frame;
         }
@@ -269,4 +310,16 @@ public:
         mouse_state[button] = now;
     }
 
+private:
+    bool running = false;
+
+    std::unordered_map<int, bool> key_state;
+    std::unordered_map<int, uint64_t> key_just_pressed_frame;
+    std::unordered_map<int, uint64_t> key_just_released_frame;
+    std::unordered_map<int, uint64_t> key_echo_frame;
+    std::unordered_map<int, uint32_t> key_repeat_count;
+
+    std::unordered_map<int, bool> mouse_state;
+    std::unordered_map<int, uint64_t> mouse_just_pressed_frame;
+    std::unordered_map<int, uint64_t> mouse_just_released_frame;
 };
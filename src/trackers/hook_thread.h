@@ -0,0 +1,130 @@
+#pragma once
+
+#include <godot_cpp/variant/string.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef __linux__
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <stdint.h>
+#include <thread>
+
+using namespace godot;
+
+// Scheduling requested for the hook thread. Zero (or an empty name) leaves a
+// setting alone, so the defaults only name the thread.
+struct HookThreadConfig {
+    // Ignored while fifo_priority is set.
+    int nice = 0;
+    // 1-99 switches the thread to SCHED_FIFO (time critical priority on Windows).
+    int fifo_priority = 0;
+    // Bit n pins the thread to CPU n.
+    int64_t affinity_mask = 0;
+    String name = "GlobalInput";
+};
+
+class HookThreadScheduler {
+public:
+    // OS id of the calling thread, what apply() expects as `id`.
+    static int64_t current_thread_id() {
+        #if defined(__linux__)
+        return (int64_t)syscall(SYS_gettid);
+        #elif defined(_WIN32)
+        return (int64_t)GetCurrentThreadId();
+        #else
+        return 0;
+        #endif
+    }
+
+    // Applies everything it can and returns what failed, empty when all succeeded.
+    static String apply(std::thread &thread, int64_t id, const HookThreadConfig &config) {
+        String errors;
+
+        #if defined(__linux__)
+        pthread_t handle = thread.native_handle();
+
+        int err = 0;
+        if (config.fifo_priority > 0 || config.nice != 0) {
+            // A nice value needs SCHED_OTHER, which also undoes an earlier SCHED_FIFO.
+            struct sched_param param = {};
+            int policy = SCHED_OTHER;
+            if (config.fifo_priority > 0) {
+                policy = SCHED_FIFO;
+                param.sched_priority = config.fifo_priority;
+            }
+            err = pthread_setschedparam(handle, policy, &param);
+            if (err != 0) add_error(errors, "scheduling policy", strerror(err));
+
+            if (policy == SCHED_OTHER && setpriority(PRIO_PROCESS, (id_t)id, config.nice) < 0) {
+                add_error(errors, "nice value", strerror(errno));
+            }
+        }
+
+        if (config.affinity_mask != 0) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            for (int cpu = 0; cpu < 64; cpu++) {
+                if (config.affinity_mask & ((int64_t)1 << cpu)) CPU_SET(cpu, &cpus);
+            }
+            err = pthread_setaffinity_np(handle, sizeof(cpus), &cpus);
+            if (err != 0) add_error(errors, "CPU affinity", strerror(err));
+        }
+
+        if (!config.name.is_empty()) {
+            // Linux thread names are limited to 15 bytes.
+            char name[16] = {};
+            strncpy(name, config.name.utf8().get_data(), sizeof(name) - 1);
+            err = pthread_setname_np(handle, name);
+            if (err != 0) add_error(errors, "thread name", strerror(err));
+        }
+
+        #elif defined(_WIN32)
+        HANDLE handle = OpenThread(THREAD_SET_INFORMATION | THREAD_SET_LIMITED_INFORMATION, FALSE, (DWORD)id);
+        if (!handle) return "Failed to open the hook thread (error " + String::num_int64(GetLastError()) + ")";
+
+        if ((config.fifo_priority > 0 || config.nice != 0) && !SetThreadPriority(handle, windows_priority(config))) {
+            add_error(errors, "thread priority", "error " + String::num_int64(GetLastError()));
+        }
+
+        if (config.affinity_mask != 0 && SetThreadAffinityMask(handle, (DWORD_PTR)config.affinity_mask) == 0) {
+            add_error(errors, "CPU affinity", "error " + String::num_int64(GetLastError()));
+        }
+
+        if (!config.name.is_empty()) {
+            SetThreadDescription(handle, (const wchar_t *)config.name.utf16().get_data());
+        }
+
+        CloseHandle(handle);
+        #endif
+
+        return errors;
+    }
+
+private:
+    static void add_error(String &errors, const char *setting, const String &reason) {
+        if (!errors.is_empty()) errors += ", ";
+        errors += String("failed to set ") + setting + ": " + reason;
+    }
+
+    #ifdef _WIN32
+    // Windows has no nice values, so they map onto the nearest priority class level.
+    static int windows_priority(const HookThreadConfig &config) {
+        if (config.fifo_priority > 0) return THREAD_PRIORITY_TIME_CRITICAL;
+        if (config.nice <= -10) return THREAD_PRIORITY_HIGHEST;
+        if (config.nice < 0) return THREAD_PRIORITY_ABOVE_NORMAL;
+        if (config.nice >= 10) return THREAD_PRIORITY_LOWEST;
+        if (config.nice > 0) return THREAD_PRIORITY_BELOW_NORMAL;
+        return THREAD_PRIORITY_NORMAL;
+    }
+    #endif
+};
@@ -0,0 +1,1200 @@
+#pragma once
+#include "common.h"
+#include "motion_estimator.h"
+#include "shared_state.h"
+
+#include <cmath>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+using namespace godot;
+
+// Shared input state for the native backends.
+// One hub per backend type owns the devices and the hook thread. Every started
+// GlobalInput holds a reference to it through a HubInputView, so the first start()
+// opens the devices and the last stop() closes them.
+class InputHub {
+public:
+    enum Status {
+        STATUS_STARTING,
+        STATUS_READY,
+        STATUS_FAILED,
+    };
+
+    virtual ~InputHub() {}
+
+    // With `async` the keymap and device enumeration run on the hook thread and
+    // the hub stays in STATUS_STARTING until they are done. `setup` runs on the
+    // hub before it opens, or right away when it is already shared.
+    template <typename T>
+    static T *acquire(bool async = false, const std::function<void(T *)> &setup = nullptr) {
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        T *&instance = instance_slot<T>();
+
+        if (!instance) {
+            T *created = new T();
+            if (setup) setup(created);
+            InputHub *hub = created;
+            hub->clear_slot = &clear_instance<T>;
+            hub->running = true;
+
+            hub->thread_id = hub->thread_id_promise.get_future().share();
+
+            if (async) {
+                hub->hook_thread = std::thread(&InputHub::thread_main, hub, true);
+            } else {
+                if (!hub->prepare()) {
+                    delete hub;
+                    return nullptr;
+                }
+                hub->hook_thread = std::thread(&InputHub::thread_main, hub, false);
+            }
+            // Named from the start, views only apply scheduling they were given.
+            HookThreadScheduler::apply(hub->hook_thread, hub->thread_id.get(), HookThreadConfig());
+            instance = created;
+        } else if (setup) {
+            setup(instance);
+        }
+
+        instance->users++;
+        return instance;
+    }
+
+    static void release(InputHub *hub) {
+        if (!hub) return;
+
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        if (--hub->users > 0) return;
+
+        hub->running = false;
+        hub->wake();
+        if (hub->hook_thread.joinable())
+            hub->hook_thread.join();
+        hub->close();
+
+        hub->clear_slot();
+        delete hub;
+    }
+
+    // Returns what could not be applied, empty on success. Every view shares the
+    // one hook thread, so the last config applied wins.
+    String apply_thread_config(const HookThreadConfig &config) {
+        if (thread_id.wait_for(std::chrono::seconds(1)) != std::future_status::ready) {
+            return "hook thread did not start";
+        }
+        return HookThreadScheduler::apply(hook_thread, thread_id.get(), config);
+    }
+
+    // Streams edges to local socket clients, only where the backend supports it.
+    // An empty path stops the server.
+    virtual bool set_event_stream(const std::string &path) { return path.empty(); }
+    virtual uint64_t get_event_stream_dropped() { return 0; }
+
+    // Switch chatter filtering, only where the backend decodes raw key events.
+    virtual void set_debounce(int mode, int msec) {}
+    virtual void set_key_debounce(int key, int msec) {}
+    virtual uint64_t get_debounce_suppressed() { return 0; }
+
+    // Godot keys a view wants decoded, empty for all of them. The backend decodes
+    // the union over every started view, so a view with an empty set keeps all
+    // keys tracked. Modifiers always count as tracked since action matching reads them.
+    void set_tracked_keys(const void *view, const std::vector<int> &keys) {
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        view_tracked_keys[view] = keys;
+        update_tracked_keys();
+    }
+
+    void remove_tracked_keys(const void *view) {
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        if (view_tracked_keys.erase(view)) update_tracked_keys();
+    }
+
+    bool is_key_tracked(int key) const {
+        return tracked_keys.empty() || tracked_keys.count(key) || GlobalInputCommon::modifier_for_key(key) != 0;
+    }
+
+    // Only backends that translate raw scancodes care about the layout.
+    virtual void set_keyboard_layout(const String &layout, const String &variant) {}
+
+    // Devices the hub reads from, as dictionaries with path, name and role.
+    virtual Array get_devices() { return Array(); }
+
+    Status get_status() const { return status.load(std::memory_order_acquire); }
+
+    // Hook thread side. Callers hold state_mutex.
+
+    void set_key(int key, bool pressed) {
+        if (set_edge(SHARED_EVENT_KEY, key_state, key_press_edge, key_release_edge, key, pressed) && pressed)
+            key_repeat_count[key] = 0;
+    }
+
+    // Raw key codes in the backend's own code space (evdev codes on Linux), kept
+    // for every code whether or not the layout maps it to a Godot key.
+    static constexpr int PHYSICAL_CODE_COUNT = 1024;
+
+    void set_physical_key(int code, bool pressed) {
+        if (code < 0 || code >= PHYSICAL_CODE_COUNT) return;
+        uint64_t bit = (uint64_t)1 << (code % 64);
+        uint64_t &word = physical_bits[code / 64];
+        if (((word & bit) != 0) == pressed) return;
+        word = pressed ? (word | bit) : (word & ~bit);
+
+        EdgeStamp stamp;
+        stamp.serial = ++edge_serial;
+        stamp.usec = edge_time();
+        if (pressed) physical_press_edge[code] = stamp;
+        else physical_release_edge[code] = stamp;
+    }
+
+    bool is_physical_code_pressed(int code) const {
+        if (code < 0 || code >= PHYSICAL_CODE_COUNT) return false;
+        return (physical_bits[code / 64] >> (code % 64)) & 1;
+    }
+
+    // Godot physical keycode (its US QWERTY position) -> backend code, -1 where
+    // the backend has no physical codes.
+    virtual int physical_code_for(int key) const { return -1; }
+
+    // Sided modifier keys. The generic Godot key stays down while either side is.
+    void set_modifier(uint32_t bit, bool pressed) {
+        uint32_t mask = modifier_mask.load(std::memory_order_relaxed);
+        mask = pressed ? (mask | bit) : (mask & ~bit);
+        modifier_mask.store(mask, std::memory_order_release);
+        set_key(GlobalInputCommon::modifier_key(bit), (mask & GlobalInputCommon::modifier_group(bit)) != 0);
+    }
+
+    // OS autorepeat of a held key. It changes no state, so it is only counted and
+    // stamped, and never reaches shared memory or the event stream.
+    void repeat_key(int key) {
+        auto it = key_state.find(key);
+        if (it == key_state.end() || !it->second) return;
+
+        key_repeat_count[key]++;
+        EdgeStamp &stamp = key_repeat_edge[key];
+        stamp.serial = ++edge_serial;
+        stamp.usec = edge_time();
+    }
+
+    void set_mouse_button(int button, bool pressed) {
+        set_edge(SHARED_EVENT_MOUSE_BUTTON, mouse_state, mouse_press_edge, mouse_release_edge, button, pressed);
+    }
+
+    void set_joy_button(int pad, int button, bool pressed) {
+        set_edge(SHARED_EVENT_JOY_BUTTON, joy_state, joy_press_edge, joy_release_edge, joy_code(pad, button), pressed);
+    }
+
+    // Backends call this after each batch of events, under state_mutex.
+    void publish_pointer() {
+        if (shared_state) shared_state->set_pointer(mouse_position.x, mouse_position.y, wheel_delta);
+    }
+
+    // Publishes the state into a named shared memory region for other local
+    // processes, see shared_state.h for the layout. An empty name stops publishing.
+    bool set_shared_memory(const std::string &name) {
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        if (shared_state && shared_state_name == name) return true;
+
+        shared_state.reset();
+        shared_state_name = name;
+        if (name.empty()) return true;
+
+        std::unique_ptr<SharedStatePublisher> publisher(new SharedStatePublisher());
+        if (!publisher->open(name)) return false;
+
+        // Keys already held show up as pressed right away.
+        SharedInputEvent held = {};
+        held.time_usec = MotionEstimator::now_usec();
+        held.pressed = 1;
+        for (const auto &[key, down] : key_state) {
+            if (!down) continue;
+            held.type = SHARED_EVENT_KEY;
+            held.code = key;
+            publisher->push_edge(held);
+        }
+        for (const auto &[button, down] : mouse_state) {
+            if (!down) continue;
+            held.type = SHARED_EVENT_MOUSE_BUTTON;
+            held.code = button;
+            publisher->push_edge(held);
+        }
+        publisher->set_pointer(mouse_position.x, mouse_position.y, wheel_delta);
+
+        shared_state = std::move(publisher);
+        return true;
+    }
+
+    // Axis directions also act as virtual buttons, so joypad motion bindings get edges.
+    void set_joy_axis(int pad, int axis, float value) {
+        joy_axis[joy_code(pad, axis)] = value;
+        set_joy_button(pad, joy_axis_direction(axis, false), value <= -JOY_AXIS_PRESS_THRESHOLD);
+        set_joy_button(pad, joy_axis_direction(axis, true), value >= JOY_AXIS_PRESS_THRESHOLD);
+    }
+
+    // Joypad state is keyed by pad index and button/axis.
+    static constexpr int JOY_CODES_PER_PAD = 256;
+    static constexpr float JOY_AXIS_PRESS_THRESHOLD = 0.5f;
+
+    static int joy_code(int pad, int code) { return pad * JOY_CODES_PER_PAD + code; }
+    static int joy_axis_direction(int axis, bool positive) { return JOY_BUTTON_MAX + axis * 2 + (positive ? 1 : 0); }
+
+    // Desktop bounds and the real cursor, read from DisplayServer on the main thread.
+    // Backends that only see deltas keep the cursor inside these bounds.
+    void sync_screen(const Rect2 &rect, const Vector2 &cursor) {
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        screen_rect = rect;
+        mouse_position = clamp_to_screen(cursor);
+    }
+
+    void move_mouse(const Vector2 &delta) {
+        mouse_position = clamp_to_screen(mouse_position + delta);
+    }
+
+    // Cursor positions, one per hardware report, kept only while a view wants paths.
+    static constexpr uint64_t PATH_CAPACITY = 4096;
+
+    void record_path_sample() {
+        if (path_users.load() == 0) return;
+        if (path_ring.size() != PATH_CAPACITY) path_ring.resize(PATH_CAPACITY);
+        path_ring[path_written % PATH_CAPACITY] = mouse_position;
+        path_written++;
+    }
+
+    Vector2 clamp_to_screen(const Vector2 &point) const {
+        if (!screen_rect.has_area()) return point;
+        Vector2 end = screen_rect.get_end() - Vector2(1, 1);
+        return Vector2(
+            std::fmin(std::fmax(point.x, screen_rect.position.x), end.x),
+            std::fmin(std::fmax(point.y, screen_rect.position.y), end.y));
+    }
+
+    // Without power saving a backend may poll on a timer; with it the hook thread
+    // only wakes for input. Backends that can always block ignore it.
+    void set_power_saving(bool enabled) {
+        if (power_saving.exchange(enabled) != enabled) wake();
+    }
+
+    // Times the hook thread returned from waiting, for measuring idle wakeups.
+    std::atomic<uint64_t> wakeups{0};
+
+    // Edges are stamped with a global serial instead of a frame number, so every
+    // view can bucket them against its own frame counter, and with the source's
+    // event time for time based buffering.
+    std::atomic<uint64_t> edge_serial{0};
+
+    struct EdgeStamp {
+        uint64_t serial = 0;
+        uint64_t usec = 0; // steady clock
+    };
+
+    // Time of the event being processed, set by backends whose source reports one
+    // (kernel timestamps on evdev). 0 stamps edges with the time they are recorded.
+    uint64_t event_time_usec = 0;
+
+    uint64_t edge_time() const {
+        return event_time_usec != 0 ? event_time_usec : MotionEstimator::now_usec();
+    }
+
+    std::recursive_mutex state_mutex;
+
+    std::unordered_map<int, bool> key_state;
+    std::unordered_map<int, EdgeStamp> key_press_edge;
+    std::unordered_map<int, EdgeStamp> key_release_edge;
+    std::unordered_map<int, EdgeStamp> key_repeat_edge;
+    std::unordered_map<int, uint32_t> key_repeat_count; // since the last press
+
+    uint64_t physical_bits[PHYSICAL_CODE_COUNT / 64] = {};
+    std::unordered_map<int, EdgeStamp> physical_press_edge;
+    std::unordered_map<int, EdgeStamp> physical_release_edge;
+
+    // GlobalInputCommon::Modifier bits, written on modifier edges and read without the lock.
+    std::atomic<uint32_t> modifier_mask{0};
+
+    std::unordered_map<int, bool> mouse_state;
+    std::unordered_map<int, EdgeStamp> mouse_press_edge;
+    std::unordered_map<int, EdgeStamp> mouse_release_edge;
+
+    std::unordered_map<int, bool> joy_state;
+    std::unordered_map<int, EdgeStamp> joy_press_edge;
+    std::unordered_map<int, EdgeStamp> joy_release_edge;
+    std::unordered_map<int, float> joy_axis;
+    int joy_pads = 0;
+
+    // Applied on the hook thread before axis values are stored.
+    std::atomic<float> joy_deadzone{0.2f};
+
+    Rect2 screen_rect;
+    Vector2 mouse_position;
+    int wheel_delta = 0;
+    MotionEstimator motion;
+
+    std::unique_ptr<SharedStatePublisher> shared_state;
+    std::string shared_state_name;
+
+    std::atomic<int> path_users{0};
+    std::vector<Vector2> path_ring;
+    uint64_t path_written = 0;
+
+    // Pen tablets: pressure in [0, 1], tilt per axis in [-1, 1].
+    float pen_pressure = 0.0f;
+    Vector2 pen_tilt;
+
+protected:
+    // Opens the devices. Runs on the thread calling the first acquire(), or on the
+    // hook thread for async starts.
+    virtual bool open() = 0;
+    // Hook thread body, returns once `running` is cleared.
+    virtual void run() = 0;
+    virtual void close() = 0;
+    // Interrupts a blocking wait in run() so it notices `running` or the power mode.
+    virtual void wake() {}
+    // Called for every edge under state_mutex, after it was recorded.
+    virtual void on_edge(const SharedInputEvent &event) {}
+    // Called on the opening thread once the hub is READY, without state_mutex.
+    virtual void on_ready() {}
+    // Called under state_mutex when the tracked keys change. Backends that can
+    // filter before decoding apply it here, and again once their devices are open.
+    virtual void apply_tracked_keys() {}
+
+    // Union of view_tracked_keys, empty for all keys.
+    std::unordered_set<int> tracked_keys;
+
+    std::atomic<bool> running{false};
+    std::atomic<bool> power_saving{false};
+    std::thread hook_thread;
+    std::promise<int64_t> thread_id_promise;
+    std::shared_future<int64_t> thread_id;
+
+    KeyMaps key_maps;
+    std::unordered_map<int, int> key_map;
+
+private:
+    int users = 0;
+    void (*clear_slot)() = nullptr;
+    std::atomic<Status> status{STATUS_STARTING};
+
+    std::unordered_map<const void *, std::vector<int>> view_tracked_keys;
+
+    // Callers hold state_mutex.
+    void update_tracked_keys() {
+        std::unordered_set<int> merged;
+        for (const auto &[view, keys] : view_tracked_keys) {
+            if (keys.empty()) {
+                merged.clear();
+                break;
+            }
+            merged.insert(keys.begin(), keys.end());
+        }
+        if (merged == tracked_keys) return;
+        tracked_keys = std::move(merged);
+        apply_tracked_keys();
+
+        // Nothing would ever release a key that stopped being tracked while held.
+        std::vector<int> held;
+        for (const auto &[key, down] : key_state) {
+            if (down && !is_key_tracked(key)) held.push_back(key);
+        }
+        for (int key : held) set_key(key, false);
+    }
+
+    bool prepare() {
+        key_maps.get_platform_key_mapping(key_map);
+        if (!open()) {
+            status.store(STATUS_FAILED, std::memory_order_release);
+            return false;
+        }
+        status.store(STATUS_READY, std::memory_order_release);
+        on_ready();
+        return true;
+    }
+
+    void thread_main(bool open_first) {
+        thread_id_promise.set_value(HookThreadScheduler::current_thread_id());
+        if (open_first && !prepare()) return;
+        run();
+    }
+
+    void publish_edge(uint32_t type, int code, bool pressed, uint64_t usec) {
+        SharedInputEvent event = {};
+        event.time_usec = usec;
+        event.type = type;
+        event.code = code;
+        event.pressed = pressed ? 1 : 0;
+
+        if (shared_state) shared_state->push_edge(event);
+        on_edge(event);
+    }
+
+    // Records and publishes the edge, returns false when the state didn't change.
+    bool set_edge(uint32_t type, std::unordered_map<int, bool> &states, std::unordered_map<int, EdgeStamp> &press,
+            std::unordered_map<int, EdgeStamp> &release, int code, bool pressed) {
+        bool &down = states[code];
+        if (down == pressed) return false;
+        down = pressed;
+
+        EdgeStamp stamp;
+        stamp.serial = ++edge_serial;
+        stamp.usec = edge_time();
+        if (pressed) press[code] = stamp;
+        else release[code] = stamp;
+
+        publish_edge(type, code, pressed, stamp.usec);
+        return true;
+    }
+
+    static std::mutex &registry_mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    template <typename T>
+    static T *&instance_slot() {
+        static T *instance = nullptr;
+        return instance;
+    }
+
+    template <typename T>
+    static void clear_instance() { instance_slot<T>() = nullptr; }
+};
+
+// Per-node view of a shared hub. Holds nothing but its own frame counter and the
+// edge serials seen at the last few frame boundaries.
+class HubInputView : public GlobalInputCommon {
+public:
+    ~HubInputView() { stop(); }
+
+    void start() override {
+        if (hub) return;
+        if (!OS::get_singleton()) return;
+        if (OS::get_singleton()->has_feature("editor_hint")) return;
+
+        hub = acquire_hub(async_start);
+        if (!hub) {
+            godot::print_line("Global Input: Failed to start the input hook.");
+            return;
+        }
+
+        if (!layout.is_empty()) hub->set_keyboard_layout(layout, variant);
+        if (joy_deadzone_set) hub->joy_deadzone = joy_deadzone;
+        if (power_saving_set) hub->set_power_saving(power_saving);
+        if (debounce_set) hub->set_debounce(debounce_mode, debounce_msec);
+        for (const auto &[key, msec] : key_debounce_msec) hub->set_key_debounce(key, msec);
+        hub->set_tracked_keys(this, tracked_keys);
+        if (thread_config_set) apply_thread_config();
+        if (!shared_memory_name.is_empty()) publish_shared_memory();
+        if (!event_stream_path.is_empty()) start_event_stream();
+        sync_screen();
+
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        motion_mark_x = hub->motion.get_total_x();
+        motion_mark_y = hub->motion.get_total_y();
+        wheel_mark = hub->wheel_delta;
+        frame_delta = Vector2();
+        frame_wheel = 0;
+
+        if (motion_mode == MOTION_PATH) hub->path_users++;
+        path_read = hub->path_written;
+        frame_path.clear();
+    }
+
+    void stop() override {
+        if (!hub) return;
+        if (motion_mode == MOTION_PATH) hub->path_users--;
+        hub->remove_tracked_keys(this);
+        InputHub::release(hub);
+        hub = nullptr;
+    }
+
+    void set_keyboard_layout(const String &p_layout, const String &p_variant) override {
+        layout = p_layout;
+        variant = p_variant;
+        if (hub) hub->set_keyboard_layout(layout, variant);
+    }
+
+    // Polling Data
+
+    void poll_data() override {
+        if (!hub) return;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        frame_delta = Vector2();
+        frame_wheel = 0;
+        mark_frame(current_frame % FRAME_MARKS);
+
+        if (motion_mode == MOTION_PATH) collect_path();
+
+        update_wakeup_rate();
+    }
+
+    void increment_frame() override {
+        current_frame++;
+    }
+
+    // Moves the latest frame boundary up to now under the same lock the rest is
+    // read under, so what happened since poll_data() joins this frame instead of
+    // making held keys disagree with the edges.
+    void capture_snapshot(InputSnapshot &snapshot) override {
+        snapshot.begin(current_frame);
+        if (!hub) return;
+
+        const PackedStringArray actions = snapshot.get_actions();
+        snapshot_bindings.resize(actions.size());
+        for (int i = 0; i < (int)actions.size(); i++) load_bindings(actions[i], snapshot_bindings[i]);
+
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        if (current_frame > 0) mark_frame((current_frame - 1) % FRAME_MARKS);
+
+        for (const auto &[key, down] : hub->key_state) {
+            if (down) snapshot.set_key(key, InputSnapshot::STATE_PRESSED);
+        }
+        for (const auto &[key, edge] : hub->key_press_edge) {
+            if (serial_in_buffer(edge.serial)) snapshot.set_key(key, InputSnapshot::STATE_JUST_PRESSED);
+        }
+        for (const auto &[key, edge] : hub->key_release_edge) {
+            if (serial_in_buffer(edge.serial)) snapshot.set_key(key, InputSnapshot::STATE_JUST_RELEASED);
+        }
+
+        for (const auto &[button, down] : hub->mouse_state) {
+            if (down) snapshot.set_mouse_button(button, InputSnapshot::STATE_PRESSED);
+        }
+        for (const auto &[button, edge] : hub->mouse_press_edge) {
+            if (serial_in_buffer(edge.serial)) snapshot.set_mouse_button(button, InputSnapshot::STATE_JUST_PRESSED);
+        }
+        for (const auto &[button, edge] : hub->mouse_release_edge) {
+            if (serial_in_buffer(edge.serial)) snapshot.set_mouse_button(button, InputSnapshot::STATE_JUST_RELEASED);
+        }
+
+        snapshot.set_modifier_mask(hub->modifier_mask.load(std::memory_order_acquire));
+        snapshot.set_pointer(hub->mouse_position, frame_delta, frame_wheel);
+
+        for (int i = 0; i < (int)actions.size(); i++) {
+            snapshot.set_action_state(i, match_bindings(snapshot_bindings[i], SNAPSHOT_QUERIES, QueryTiming()));
+        }
+    }
+
+    // Basic Key Input
+
+    bool is_key_pressed(int key) override {
+        if (!hub) return false;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        auto it = hub->key_state.find(key);
+        return it != hub->key_state.end() && it->second;
+    }
+
+    bool is_key_just_pressed(int key) override {
+        if (!hub) return false;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return edge_in_buffer(hub->key_press_edge, key);
+    }
+
+    bool is_key_just_released(int key) override {
+        if (!hub) return false;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return edge_in_buffer(hub->key_release_edge, key);
+    }
+
+    // Mouse Input
+
+    bool is_mouse_pressed(int button) override {
+        if (!hub) return false;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        auto it = hub->mouse_state.find(button);
+        return it != hub->mouse_state.end() && it->second;
+    }
+
+    bool is_mouse_just_pressed(int button) override {
+        if (!hub) return false;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return edge_in_buffer(hub->mouse_press_edge, button);
+    }
+
+    bool is_mouse_just_released(int button) override {
+        if (!hub) return false;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return edge_in_buffer(hub->mouse_release_edge, button);
+    }
+
+    void set_debounce(int mode, int msec) override {
+        debounce_mode = mode;
+        debounce_msec = msec;
+        debounce_set = true;
+        if (hub) hub->set_debounce(mode, msec);
+    }
+
+    void set_key_debounce(int key, int msec) override {
+        if (msec < 0) key_debounce_msec.erase(key);
+        else key_debounce_msec[key] = msec;
+        if (hub) hub->set_key_debounce(key, msec);
+    }
+
+    int64_t get_debounce_suppressed() override {
+        return hub ? (int64_t)hub->get_debounce_suppressed() : 0;
+    }
+
+    void set_tracked_keys(const PackedInt32Array &keys) override {
+        tracked_keys.assign(keys.ptr(), keys.ptr() + keys.size());
+        if (hub) hub->set_tracked_keys(this, tracked_keys);
+    }
+
+    // Physical keys
+
+    bool is_physical_key_pressed(int key) override {
+        if (!hub) return false;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        int code = modifier_for_key(key) != 0 ? -1 : hub->physical_code_for(key);
+        if (code < 0) return is_set(hub->key_state, key);
+        return hub->is_physical_code_pressed(code);
+    }
+
+    bool is_scancode_pressed(int code) override {
+        if (!hub) return false;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return hub->is_physical_code_pressed(code);
+    }
+
+    // Modifiers
+
+    uint32_t get_modifier_mask() override {
+        return hub ? hub->modifier_mask.load(std::memory_order_acquire) : 0;
+    }
+
+    bool is_shift_pressed() override { return (get_modifier_mask() & MODIFIER_SHIFT) != 0; }
+    bool is_ctrl_pressed() override { return (get_modifier_mask() & MODIFIER_CTRL) != 0; }
+    bool is_alt_pressed() override { return (get_modifier_mask() & MODIFIER_ALT) != 0; }
+    bool is_meta_pressed() override { return (get_modifier_mask() & MODIFIER_META) != 0; }
+
+    // Key repeat
+
+    bool is_key_echo(int key) override {
+        if (!hub) return false;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return is_set(hub->key_state, key) && edge_in_buffer(hub->key_repeat_edge, key);
+    }
+
+    int get_key_repeat_count(int key) override {
+        if (!hub) return 0;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        if (!is_set(hub->key_state, key)) return 0;
+        auto it = hub->key_repeat_count.find(key);
+        return it != hub->key_repeat_count.end() ? (int)it->second : 0;
+    }
+
+    bool is_action_repeating(const String &action, int delay_msec, float rate) override {
+        if (delay_msec < 0 || rate <= 0.0f) return false;
+        QueryTiming timing;
+        timing.repeat_delay_usec = (uint64_t)delay_msec * 1000;
+        timing.repeat_rate = rate;
+        return match_action(action, QUERY_REPEAT, timing);
+    }
+
+    // Time based buffers
+
+    bool is_key_pressed_within(int key, int msec) override {
+        if (!hub || msec < 0) return false;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return edge_within(hub->key_press_edge, key, (uint64_t)msec * 1000);
+    }
+
+    bool is_mouse_pressed_within(int button, int msec) override {
+        if (!hub || msec < 0) return false;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return edge_within(hub->mouse_press_edge, button, (uint64_t)msec * 1000);
+    }
+
+    bool is_action_buffered(const String &action, int msec) override {
+        if (msec < 0) return false;
+        QueryTiming timing;
+        timing.window_usec = (uint64_t)msec * 1000;
+        return match_action(action, QUERY_BUFFERED, timing);
+    }
+
+    Vector2 get_mouse_position() override {
+        if (!hub) return Vector2();
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return hub->mouse_position;
+    }
+
+    Vector2 get_mouse_delta() override {
+        return frame_delta;
+    }
+
+    void set_thread_config(const HookThreadConfig &config) override {
+        thread_config = config;
+        thread_config_set = true;
+        if (hub) apply_thread_config();
+    }
+
+    String get_thread_config_error() override {
+        return thread_config_error;
+    }
+
+    void set_shared_memory_name(const String &name) override {
+        shared_memory_name = name;
+        if (hub) publish_shared_memory();
+    }
+
+    void set_event_stream_path(const String &path) override {
+        event_stream_path = path;
+        if (hub) start_event_stream();
+    }
+
+    int64_t get_event_stream_dropped() override {
+        return hub ? (int64_t)hub->get_event_stream_dropped() : 0;
+    }
+
+    void set_power_saving(bool enabled) override {
+        power_saving = enabled;
+        power_saving_set = true;
+        if (hub) hub->set_power_saving(enabled);
+    }
+
+    double get_hook_wakeups_per_second() override {
+        return wakeup_rate;
+    }
+
+    void set_motion_mode(int mode) override {
+        if (mode == motion_mode) return;
+        if (hub) {
+            std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+            if (mode == MOTION_PATH) hub->path_users++;
+            else hub->path_users--;
+            path_read = hub->path_written;
+        }
+        motion_mode = mode;
+        frame_path.clear();
+    }
+
+    PackedVector2Array get_mouse_path() override {
+        return frame_path;
+    }
+
+    Vector2 get_mouse_velocity() override {
+        if (!hub) return Vector2();
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return hub->motion.get_velocity(MotionEstimator::now_usec());
+    }
+
+    Vector2 get_mouse_acceleration() override {
+        if (!hub) return Vector2();
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return hub->motion.get_acceleration(MotionEstimator::now_usec());
+    }
+
+    float get_pen_pressure() override {
+        if (!hub) return 0.0f;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return hub->pen_pressure;
+    }
+
+    Vector2 get_pen_tilt() override {
+        if (!hub) return Vector2();
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return hub->pen_tilt;
+    }
+
+    // Joypad Input
+
+    bool is_joy_button_pressed(int device, int button) override {
+        if (!hub) return false;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return is_set(hub->joy_state, InputHub::joy_code(device, button));
+    }
+
+    float get_joy_axis(int device, int axis) override {
+        if (!hub) return 0.0f;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        auto it = hub->joy_axis.find(InputHub::joy_code(device, axis));
+        return it != hub->joy_axis.end() ? it->second : 0.0f;
+    }
+
+    void set_joy_deadzone(float deadzone) override {
+        joy_deadzone = deadzone;
+        joy_deadzone_set = true;
+        if (hub) hub->joy_deadzone = deadzone;
+    }
+
+    // Godot InputMap Action Detection
+
+    bool is_action_pressed(const String &action) override {
+        return match_action(action, QUERY_PRESSED, QueryTiming());
+    }
+
+    bool is_action_just_pressed(const String &action) override {
+        return match_action(action, QUERY_JUST_PRESSED, QueryTiming());
+    }
+
+    bool is_action_just_released(const String &action) override {
+        return match_action(action, QUERY_JUST_RELEASED, QueryTiming());
+    }
+
+    // Debug Returns
+
+    Dictionary get_keys_pressed_detailed() override {
+        Dictionary dict;
+        if (!hub) return dict;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        for (const auto &[key, down] : hub->key_state) {
+            if (!down) continue;
+            dict[key_name(key)] = true;
+            dict["os"] = os_name();
+        }
+        return dict;
+    }
+
+    Dictionary get_keys_just_pressed_detailed() override {
+        return keys_in_buffer(&InputHub::key_press_edge);
+    }
+
+    Dictionary get_keys_just_released_detailed() override {
+        return keys_in_buffer(&InputHub::key_release_edge);
+    }
+
+    void handle_input(const Ref<InputEvent> &event) override {}
+
+    Array get_devices() override {
+        return is_hook_ready() ? hub->get_devices() : Array();
+    }
+
+    bool is_hook_ready() override {
+        return hub && hub->get_status() == InputHub::STATUS_READY;
+    }
+
+    bool is_hook_failed() override {
+        return !hub || hub->get_status() == InputHub::STATUS_FAILED;
+    }
+
+protected:
+    InputHub *hub = nullptr;
+
+    virtual InputHub *acquire_hub(bool async) = 0;
+    virtual const char *os_name() const = 0;
+
+private:
+    static constexpr uint64_t FRAME_MARKS = 8;
+    static_assert(JUST_BUFFER_FRAMES + 1 < FRAME_MARKS, "frame mark ring too small for the just buffer");
+
+    uint64_t frame_marks[FRAME_MARKS] = {};
+    uint64_t frame_usec[FRAME_MARKS] = {};
+    String layout;
+    String variant;
+
+    // The *_set flags keep a view from pushing defaults it never chose onto the
+    // shared hub, over what other views set.
+    float joy_deadzone = 0.2f;
+    bool joy_deadzone_set = false;
+
+    HookThreadConfig thread_config;
+    String thread_config_error;
+    bool thread_config_set = false;
+    String shared_memory_name;
+    String event_stream_path;
+
+    bool power_saving = false;
+    bool power_saving_set = false;
+    double wakeup_rate = 0.0;
+
+    int debounce_mode = DEBOUNCE_EAGER;
+    int debounce_msec = 0;
+    bool debounce_set = false;
+    std::unordered_map<int, int> key_debounce_msec;
+    std::vector<int> tracked_keys;
+    uint64_t wakeup_mark = 0;
+    uint64_t wakeup_mark_usec = 0;
+
+    int motion_mode = MOTION_COALESCED;
+    uint64_t path_read = 0;
+    PackedVector2Array frame_path;
+
+    double motion_mark_x = 0.0;
+    double motion_mark_y = 0.0;
+    Vector2 frame_delta;
+    int wheel_mark = 0;
+    int frame_wheel = 0;
+
+    // Records a frame boundary in `slot` and adds the motion and wheel since the
+    // previous one, taken per view so they don't depend on who else polls.
+    // Callers hold state_mutex.
+    void mark_frame(uint64_t slot) {
+        frame_marks[slot] = hub->edge_serial.load();
+        frame_usec[slot] = MotionEstimator::now_usec();
+
+        double total_x = hub->motion.get_total_x();
+        double total_y = hub->motion.get_total_y();
+        frame_delta += Vector2((float)(total_x - motion_mark_x), (float)(total_y - motion_mark_y));
+        motion_mark_x = total_x;
+        motion_mark_y = total_y;
+
+        frame_wheel += hub->wheel_delta - wheel_mark;
+        wheel_mark = hub->wheel_delta;
+    }
+
+    // True if the edge landed between the frame boundary JUST_BUFFER_FRAMES ago and the latest one.
+    bool serial_in_buffer(uint64_t serial) const {
+        if (serial == 0 || current_frame == 0) return false;
+
+        uint64_t newest = frame_marks[(current_frame - 1) % FRAME_MARKS];
+        uint64_t oldest = current_frame > JUST_BUFFER_FRAMES + 1
+            ? frame_marks[(current_frame - JUST_BUFFER_FRAMES - 1) % FRAME_MARKS]
+            : 0;
+        return serial > oldest && serial <= newest;
+    }
+
+    bool edge_in_buffer(const std::unordered_map<int, InputHub::EdgeStamp> &edges, int code) const {
+        auto it = edges.find(code);
+        return it != edges.end() && serial_in_buffer(it->second.serial);
+    }
+
+    // True if the last edge happened at most `window_usec` ago, whatever the frame rate.
+    static bool edge_within(const std::unordered_map<int, InputHub::EdgeStamp> &edges, int code, uint64_t window_usec) {
+        auto it = edges.find(code);
+        if (it == edges.end() || it->second.serial == 0) return false;
+        uint64_t now = MotionEstimator::now_usec();
+        return it->second.usec >= now || now - it->second.usec <= window_usec;
+    }
+
+    static bool is_set(const std::unordered_map<int, bool> &states, int code) {
+        auto it = states.find(code);
+        return it != states.end() && it->second;
+    }
+
+    void apply_thread_config() {
+        thread_config_error = hub->apply_thread_config(thread_config);
+        if (!thread_config_error.is_empty()) {
+            godot::print_line("Global Input: Hook thread scheduling: " + thread_config_error);
+        }
+    }
+
+    void publish_shared_memory() {
+        if (!hub->set_shared_memory(shared_memory_name.utf8().get_data())) {
+            godot::print_line("Global Input: Failed to create shared memory " + shared_memory_name);
+        }
+    }
+
+    void start_event_stream() {
+        if (!hub->set_event_stream(event_stream_path.utf8().get_data())) {
+            godot::print_line("Global Input: Failed to listen on " + event_stream_path);
+        }
+    }
+
+    // Averaged over at least a second so it reads as a steady number.
+    void update_wakeup_rate() {
+        uint64_t now = MotionEstimator::now_usec();
+        uint64_t wakeups = hub->wakeups.load();
+
+        if (wakeup_mark_usec == 0) {
+            wakeup_mark = wakeups;
+            wakeup_mark_usec = now;
+            return;
+        }
+        if (now - wakeup_mark_usec < 1000000) return;
+
+        wakeup_rate = (double)(wakeups - wakeup_mark) * 1000000.0 / (double)(now - wakeup_mark_usec);
+        wakeup_mark = wakeups;
+        wakeup_mark_usec = now;
+    }
+
+    // Copies the samples recorded since the previous frame. A view that fell more
+    // than PATH_CAPACITY reports behind keeps only the newest ones.
+    void collect_path() {
+        uint64_t written = hub->path_written;
+        uint64_t from = path_read;
+        if (written - from > InputHub::PATH_CAPACITY) from = written - InputHub::PATH_CAPACITY;
+
+        frame_path.resize((int64_t)(written - from));
+        Vector2 *out = frame_path.ptrw();
+        for (uint64_t i = from; i < written; i++) {
+            *out++ = hub->path_ring[i % InputHub::PATH_CAPACITY];
+        }
+        path_read = written;
+    }
+
+    // Bounding box of all screens, queried once per start instead of per event.
+    void sync_screen() {
+        DisplayServer *display = DisplayServer::get_singleton();
+        if (!display) return;
+
+        int count = display->get_screen_count();
+        if (count <= 0) return;
+
+        Vector2 start = display->screen_get_position(0);
+        Vector2 end = start + Vector2(display->screen_get_size(0));
+        for (int i = 1; i < count; i++) {
+            Vector2 position = display->screen_get_position(i);
+            Vector2 size = display->screen_get_size(i);
+            start = Vector2(std::fmin(start.x, position.x), std::fmin(start.y, position.y));
+            end = Vector2(std::fmax(end.x, position.x + size.x), std::fmax(end.y, position.y + size.y));
+        }
+
+        hub->sync_screen(Rect2(start, end - start), display->mouse_get_position());
+    }
+
+    // Bit flags, so one pass over a binding can answer several at once. The
+    // first three double as InputSnapshot states.
+    enum ActionQuery : uint32_t {
+        QUERY_PRESSED = InputSnapshot::STATE_PRESSED,
+        QUERY_JUST_PRESSED = InputSnapshot::STATE_JUST_PRESSED,
+        QUERY_JUST_RELEASED = InputSnapshot::STATE_JUST_RELEASED,
+        QUERY_BUFFERED = 1 << 3,
+        QUERY_REPEAT = 1 << 4,
+    };
+
+    static constexpr uint32_t SNAPSHOT_QUERIES = QUERY_PRESSED | QUERY_JUST_PRESSED | QUERY_JUST_RELEASED;
+
+    // An action's InputMap bindings, fetched before state_mutex is taken so the
+    // hook thread never waits on InputMap.
+    struct ActionBindings {
+        Array events;
+        float deadzone = 0.0f;
+    };
+
+    std::vector<ActionBindings> snapshot_bindings;
+
+    // Window of QUERY_BUFFERED and timing of QUERY_REPEAT. Passed along rather
+    // than kept on the view, since queries may come from several threads.
+    struct QueryTiming {
+        uint64_t window_usec = 0;
+        uint64_t repeat_delay_usec = 0;
+        float repeat_rate = 0.0f;
+    };
+
+    // Synthesized repeats due after holding for `held_usec`: the first after the
+    // delay, then `repeat_rate` per second.
+    static uint64_t repeat_ticks(uint64_t held_usec, const QueryTiming &timing) {
+        if (held_usec < timing.repeat_delay_usec) return 0;
+        return 1 + (uint64_t)((double)(held_usec - timing.repeat_delay_usec) * timing.repeat_rate / 1000000.0);
+    }
+
+    // True if a synthesized repeat fell between the last two frame boundaries.
+    // Worked out from the press time, so repeating costs the hook thread nothing.
+    bool repeat_in_frame(const std::unordered_map<int, InputHub::EdgeStamp> &edges, int code, const QueryTiming &timing) const {
+        auto it = edges.find(code);
+        if (it == edges.end() || current_frame == 0) return false;
+
+        uint64_t pressed = it->second.usec;
+        uint64_t newest = frame_usec[(current_frame - 1) % FRAME_MARKS];
+        uint64_t previous = current_frame > 1 ? frame_usec[(current_frame - 2) % FRAME_MARKS] : 0;
+        if (pressed >= newest) return false;
+
+        uint64_t held_before = previous > pressed ? previous - pressed : 0;
+        return repeat_ticks(newest - pressed, timing) > repeat_ticks(held_before, timing);
+    }
+
+    uint32_t query_code(uint32_t queries, const QueryTiming &timing, const std::unordered_map<int, bool> &states,
+            const std::unordered_map<int, InputHub::EdgeStamp> &press, const std::unordered_map<int, InputHub::EdgeStamp> &release, int code) const {
+        return query_edges(queries, timing, is_set(states, code), press, release, code);
+    }
+
+    // The subset of `queries` that hold for the code.
+    uint32_t query_edges(uint32_t queries, const QueryTiming &timing, bool held,
+            const std::unordered_map<int, InputHub::EdgeStamp> &press, const std::unordered_map<int, InputHub::EdgeStamp> &release, int code) const {
+        uint32_t result = 0;
+        if ((queries & QUERY_PRESSED) && held) result |= QUERY_PRESSED;
+        if ((queries & (QUERY_JUST_PRESSED | QUERY_REPEAT)) && edge_in_buffer(press, code)) result |= queries & (QUERY_JUST_PRESSED | QUERY_REPEAT);
+        if ((queries & QUERY_JUST_RELEASED) && edge_in_buffer(release, code)) result |= QUERY_JUST_RELEASED;
+        if ((queries & QUERY_BUFFERED) && edge_within(press, code, timing.window_usec)) result |= QUERY_BUFFERED;
+        if ((queries & QUERY_REPEAT) && !(result & QUERY_REPEAT) && held && repeat_in_frame(press, code, timing)) result |= QUERY_REPEAT;
+        return result;
+    }
+
+    // Bindings to a physical keycode follow the key's position, not the layout.
+    // Modifiers are a physical key on each side, their generic key already covers both.
+    uint32_t query_physical(uint32_t queries, const QueryTiming &timing, int key) const {
+        int code = modifier_for_key(key) != 0 ? -1 : hub->physical_code_for(key);
+        if (code < 0) return query_code(queries, timing, hub->key_state, hub->key_press_edge, hub->key_release_edge, key);
+        return query_edges(queries, timing, hub->is_physical_code_pressed(code), hub->physical_press_edge, hub->physical_release_edge, code);
+    }
+
+    // Device -1 in an InputMap event means any joypad.
+    uint32_t query_joy(uint32_t queries, const QueryTiming &timing, int device, int code) const {
+        uint32_t result = 0;
+        int first = device < 0 ? 0 : device;
+        int last = device < 0 ? hub->joy_pads - 1 : device;
+        for (int pad = first; pad <= last && result != queries; pad++) {
+            result |= query_code(queries, timing, hub->joy_state, hub->joy_press_edge, hub->joy_release_edge, InputHub::joy_code(pad, code));
+        }
+        return result;
+    }
+
+    // Held compares the axis with the action's deadzone, edges come from the
+    // direction's virtual button.
+    uint32_t query_joy_motion(uint32_t queries, const QueryTiming &timing, int device, int axis, float direction, float deadzone) const {
+        uint32_t result = query_joy(queries & ~QUERY_PRESSED, timing, device, InputHub::joy_axis_direction(axis, direction > 0.0f));
+        if (!(queries & QUERY_PRESSED)) return result;
+
+        int first = device < 0 ? 0 : device;
+        int last = device < 0 ? hub->joy_pads - 1 : device;
+        for (int pad = first; pad <= last; pad++) {
+            auto it = hub->joy_axis.find(InputHub::joy_code(pad, axis));
+            if (it == hub->joy_axis.end()) continue;
+            if (it->second * direction >= deadzone) return result | QUERY_PRESSED;
+        }
+        return result;
+    }
+
+    static bool load_bindings(const String &action, ActionBindings &bindings) {
+        InputMap *map = InputMap::get_singleton();
+        if (!map || !map->has_action(action)) {
+            bindings.events = Array();
+            return false;
+        }
+        bindings.events = map->action_get_events(action);
+        bindings.deadzone = map->action_get_deadzone(action);
+        return true;
+    }
+
+    bool match_action(const String &action, ActionQuery query, const QueryTiming &timing) {
+        ActionBindings bindings;
+        if (!hub || !load_bindings(action, bindings)) return false;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        return match_bindings(bindings, query, timing) != 0;
+    }
+
+    // Callers hold state_mutex.
+    uint32_t match_bindings(const ActionBindings &bindings, uint32_t queries, const QueryTiming &timing) {
+        uint32_t result = 0;
+        for (int i = 0; i < bindings.events.size() && result != queries; i++) {
+            Ref<InputEvent> ev = bindings.events[i];
+            if (ev.is_valid()) result |= match_event(ev.ptr(), bindings.deadzone, queries, timing);
+        }
+        return result;
+    }
+
+    // The subset of `queries` the binding satisfies. Callers hold state_mutex.
+    uint32_t match_event(InputEvent *ev, float deadzone, uint32_t queries, const QueryTiming &timing) {
+        if (auto *key_ev = Object::cast_to<InputEventKey>(ev)) {
+            if (!modifiers_match(key_ev)) return 0;
+            if (key_ev->get_keycode() == KEY_NONE && key_ev->get_physical_keycode() != KEY_NONE) {
+                return query_physical(queries, timing, key_ev->get_physical_keycode());
+            }
+            return query_code(queries, timing, hub->key_state, hub->key_press_edge, hub->key_release_edge, key_ev->get_keycode());
+        } else if (auto *mouse_ev = Object::cast_to<InputEventMouseButton>(ev)) {
+            if (!modifiers_match(mouse_ev)) return 0;
+            return query_code(queries, timing, hub->mouse_state, hub->mouse_press_edge, hub->mouse_release_edge, mouse_ev->get_button_index());
+        } else if (auto *joy_ev = Object::cast_to<InputEventJoypadButton>(ev)) {
+            return query_joy(queries, timing, joy_ev->get_device(), joy_ev->get_button_index());
+        } else if (auto *motion_ev = Object::cast_to<InputEventJoypadMotion>(ev)) {
+            return query_joy_motion(queries, timing, motion_ev->get_device(), motion_ev->get_axis(), motion_ev->get_axis_value(), deadzone);
+        }
+        return 0;
+    }
+
+    Dictionary keys_in_buffer(std::unordered_map<int, InputHub::EdgeStamp> InputHub::*edges) {
+        Dictionary dict;
+        if (!hub) return dict;
+        std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+        for (const auto &[key, edge] : hub->*edges) {
+            if (!serial_in_buffer(edge.serial)) continue;
+            dict[key_name(key)] = true;
+            dict["os"] = os_name();
+        }
+        return dict;
+    }
+
+    static String key_name(int key) {
+        if (OS::get_singleton() && key >= 0 && key <= KEY_MENU)
+            return OS::get_singleton()->get_keycode_string((Key)key);
+        return "Unknown";
+    }
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../keymaps.h"
+
+#ifdef __linux__
+#include <linux/input.h>
+#endif
+
+#include <cmath>
+
+using namespace godot;
+
+// evdev gamepad codes -> Godot's SDL style joypad layout.
+class EvdevJoypad {
+public:
+    #ifdef __linux__
+    static int button_for(int code) {
+        switch (code) {
+            case BTN_SOUTH: return JOY_BUTTON_A;
+            case BTN_EAST: return JOY_BUTTON_B;
+            case BTN_WEST: return JOY_BUTTON_X;
+            case BTN_NORTH: return JOY_BUTTON_Y;
+            case BTN_SELECT: return JOY_BUTTON_BACK;
+            case BTN_MODE: return JOY_BUTTON_GUIDE;
+            case BTN_START: return JOY_BUTTON_START;
+            case BTN_THUMBL: return JOY_BUTTON_LEFT_STICK;
+            case BTN_THUMBR: return JOY_BUTTON_RIGHT_STICK;
+            case BTN_TL: return JOY_BUTTON_LEFT_SHOULDER;
+            case BTN_TR: return JOY_BUTTON_RIGHT_SHOULDER;
+            case BTN_DPAD_UP: return JOY_BUTTON_DPAD_UP;
+            case BTN_DPAD_DOWN: return JOY_BUTTON_DPAD_DOWN;
+            case BTN_DPAD_LEFT: return JOY_BUTTON_DPAD_LEFT;
+            case BTN_DPAD_RIGHT: return JOY_BUTTON_DPAD_RIGHT;
+            // xpad reports the d-pad as the first trigger-happy buttons.
+            case BTN_TRIGGER_HAPPY1: return JOY_BUTTON_DPAD_LEFT;
+            case BTN_TRIGGER_HAPPY2: return JOY_BUTTON_DPAD_RIGHT;
+            case BTN_TRIGGER_HAPPY3: return JOY_BUTTON_DPAD_UP;
+            case BTN_TRIGGER_HAPPY4: return JOY_BUTTON_DPAD_DOWN;
+            default: break;
+        }
+
+        // Generic joysticks: trigger, thumb, top... numbered in order after the named buttons.
+        if (code >= BTN_JOYSTICK && code < BTN_GAMEPAD) return JOY_BUTTON_SDL_MAX + (code - BTN_JOYSTICK);
+        return -1;
+    }
+
+    static int axis_for(int code) {
+        switch (code) {
+            case ABS_X: return JOY_AXIS_LEFT_X;
+            case ABS_Y: return JOY_AXIS_LEFT_Y;
+            case ABS_RX: return JOY_AXIS_RIGHT_X;
+            case ABS_RY: return JOY_AXIS_RIGHT_Y;
+            case ABS_Z: case ABS_BRAKE: return JOY_AXIS_TRIGGER_LEFT;
+            case ABS_RZ: case ABS_GAS: return JOY_AXIS_TRIGGER_RIGHT;
+            default: return -1;
+        }
+    }
+
+    // Sticks map to [-1, 1], triggers to [0, 1]. Values inside the deadzone (or the
+    // device's own flat range, whichever is larger) snap to 0 and the rest is rescaled
+    // so output still starts at 0 at the deadzone edge.
+    static float normalize(const struct input_absinfo &range, int value, int axis, float deadzone) {
+        if (range.maximum <= range.minimum) return 0.0f;
+
+        float span = (float)(range.maximum - range.minimum);
+        float unit = (float)(value - range.minimum) / span;
+        bool trigger = axis == JOY_AXIS_TRIGGER_LEFT || axis == JOY_AXIS_TRIGGER_RIGHT;
+
+        float normalized = trigger ? unit : unit * 2.0f - 1.0f;
+        float flat = trigger ? (float)range.flat / span : (float)range.flat * 2.0f / span;
+        float zone = std::fmax(deadzone, flat);
+
+        float magnitude = std::fabs(normalized);
+        if (magnitude <= zone) return 0.0f;
+        if (zone >= 1.0f) return 0.0f;
+
+        float scaled = std::fmin((magnitude - zone) / (1.0f - zone), 1.0f);
+        return normalized < 0.0f ? -scaled : scaled;
+    }
+    #endif
+};
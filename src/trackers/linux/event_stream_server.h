@@ -0,0 +1,209 @@
+#pragma once
+
+#include "../shared_state.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <string>
+#include <vector>
+
+// Streams input edges to local clients over a Unix domain socket.
+//
+// Every batch the hook thread processes becomes at most one frame per client:
+// an EventStreamFrame header followed by `count` SharedInputEvent records.
+// A client may send a uint32_t bitmask of (1 << SharedInputEventType) at any
+// time to choose what it receives; everything is sent until it does.
+// Slow clients never stall the hook thread: once a client has
+// MAX_PENDING_BYTES unsent, further events for it are dropped and counted,
+// and the count is reported in its next frame.
+struct EventStreamFrame {
+    uint32_t magic;   // SHARED_STATE_MAGIC
+    uint32_t count;
+    uint64_t dropped; // events this client lost so far
+};
+
+#ifdef __linux__
+
+class EventStreamServer {
+public:
+    static constexpr size_t MAX_PENDING_BYTES = 64 * 1024;
+
+    ~EventStreamServer() { close(); }
+
+    bool listen(const std::string &p_path) {
+        close();
+
+        struct sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (p_path.size() >= sizeof(address.sun_path)) return false;
+        strncpy(address.sun_path, p_path.c_str(), sizeof(address.sun_path) - 1);
+
+        listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0) return false;
+
+        // A socket file left by a crashed run would make bind fail.
+        unlink(p_path.c_str());
+        if (bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) < 0 || ::listen(listen_fd, 8) < 0) {
+            ::close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+
+        path = p_path;
+        return true;
+    }
+
+    void close() {
+        for (Client &client : clients) ::close(client.fd);
+        clients.clear();
+
+        if (listen_fd >= 0) {
+            ::close(listen_fd);
+            unlink(path.c_str());
+        }
+        listen_fd = -1;
+        path.clear();
+    }
+
+    const std::string &get_path() const { return path; }
+    uint64_t get_dropped() const { return dropped; }
+    size_t get_client_count() const { return clients.size(); }
+
+    // The listening socket first, then one entry per client, in that order.
+    void add_poll_fds(std::vector<struct pollfd> &fds) const {
+        struct pollfd entry = {};
+        entry.fd = listen_fd;
+        entry.events = POLLIN;
+        fds.push_back(entry);
+
+        for (const Client &client : clients) {
+            entry.fd = client.fd;
+            entry.events = POLLIN | (client.outgoing.empty() ? 0 : POLLOUT);
+            fds.push_back(entry);
+        }
+    }
+
+    // `fds` are the entries add_poll_fds() appended, after poll() returned.
+    void service(const struct pollfd *fds, size_t count) {
+        // Walk backwards so removing a client doesn't shift the ones left to visit.
+        for (size_t i = count; i-- > 1;) {
+            size_t index = i - 1;
+            if (index >= clients.size()) continue;
+
+            Client &client = clients[index];
+            bool alive = !(fds[i].revents & (POLLERR | POLLHUP | POLLNVAL));
+            if (alive && (fds[i].revents & POLLIN)) alive = read_filter(client);
+            if (alive && (fds[i].revents & POLLOUT)) alive = send_pending(client);
+
+            if (!alive) {
+                ::close(client.fd);
+                clients.erase(clients.begin() + index);
+            }
+        }
+
+        if (count > 0 && (fds[0].revents & POLLIN)) accept_clients();
+    }
+
+    void push(const SharedInputEvent &event) {
+        for (Client &client : clients) {
+            if (!(client.filter & (1u << event.type))) continue;
+
+            size_t queued = client.outgoing.size() + sizeof(EventStreamFrame) +
+                (client.batch.size() + 1) * sizeof(SharedInputEvent);
+            if (queued > MAX_PENDING_BYTES) {
+                client.dropped++;
+                dropped++;
+                continue;
+            }
+            client.batch.push_back(event);
+        }
+    }
+
+    // Turns each client's batch into one frame and sends what the socket takes.
+    void flush() {
+        for (size_t i = clients.size(); i-- > 0;) {
+            Client &client = clients[i];
+            if (!client.batch.empty()) {
+                EventStreamFrame frame = { SHARED_STATE_MAGIC, (uint32_t)client.batch.size(), client.dropped };
+                append(client.outgoing, &frame, sizeof(frame));
+                append(client.outgoing, client.batch.data(), client.batch.size() * sizeof(SharedInputEvent));
+                client.batch.clear();
+            }
+
+            if (!send_pending(client)) {
+                ::close(client.fd);
+                clients.erase(clients.begin() + i);
+            }
+        }
+    }
+
+private:
+    struct Client {
+        int fd = -1;
+        uint32_t filter = 0xFFFFFFFF;
+        uint64_t dropped = 0;
+        std::vector<SharedInputEvent> batch;
+        std::vector<uint8_t> outgoing;
+        uint8_t filter_bytes[sizeof(uint32_t)] = {};
+        size_t filter_length = 0;
+    };
+
+    int listen_fd = -1;
+    std::string path;
+    std::vector<Client> clients;
+    uint64_t dropped = 0;
+
+    void accept_clients() {
+        int fd;
+        while ((fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+            Client client;
+            client.fd = fd;
+            clients.push_back(client);
+        }
+    }
+
+    bool read_filter(Client &client) {
+        uint8_t buffer[64];
+        ssize_t bytes;
+        while ((bytes = recv(client.fd, buffer, sizeof(buffer), 0)) > 0) {
+            for (ssize_t i = 0; i < bytes; i++) {
+                client.filter_bytes[client.filter_length++] = buffer[i];
+                if (client.filter_length == sizeof(uint32_t)) {
+                    memcpy(&client.filter, client.filter_bytes, sizeof(uint32_t));
+                    client.filter_length = 0;
+                }
+            }
+        }
+        // 0 means the client closed its end.
+        return bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+
+    bool send_pending(Client &client) {
+        size_t sent = 0;
+        while (sent < client.outgoing.size()) {
+            ssize_t bytes = send(client.fd, client.outgoing.data() + sent, client.outgoing.size() - sent,
+                MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (bytes < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                return false;
+            }
+            sent += (size_t)bytes;
+        }
+        client.outgoing.erase(client.outgoing.begin(), client.outgoing.begin() + sent);
+        return true;
+    }
+
+    static void append(std::vector<uint8_t> &out, const void *data, size_t size) {
+        const uint8_t *bytes = (const uint8_t *)data;
+        out.insert(out.end(), bytes, bytes + size);
+    }
+};
+
+#endif
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "../keymaps.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BITS_PER_LONG (sizeof(long) * 8)
+#define NBITS(x) ((((x)-1)/BITS_PER_LONG)+1)
+#define IS_SET(bit, bits) ((bits[(bit)/BITS_PER_LONG] & (1UL << ((bit) % BITS_PER_LONG))) != 0)
+#endif
+
+#include <string>
+#include <vector>
+
+using namespace godot;
+
+enum InputDeviceRole {
+    DEVICE_ROLE_NONE,
+    DEVICE_ROLE_KEYBOARD,
+    DEVICE_ROLE_POINTER,
+    DEVICE_ROLE_COMBO,
+    DEVICE_ROLE_JOYSTICK,
+    DEVICE_ROLE_TOUCH,
+};
+
+inline const char *input_device_role_name(InputDeviceRole role) {
+    switch (role) {
+        case DEVICE_ROLE_KEYBOARD: return "keyboard";
+        case DEVICE_ROLE_POINTER: return "pointer";
+        case DEVICE_ROLE_COMBO: return "combo";
+        case DEVICE_ROLE_JOYSTICK: return "joystick";
+        case DEVICE_ROLE_TOUCH: return "touch";
+        default: return "none";
+    }
+}
+
+inline InputDeviceRole input_device_role_from_name(const std::string &name) {
+    if (name == "keyboard") return DEVICE_ROLE_KEYBOARD;
+    if (name == "pointer") return DEVICE_ROLE_POINTER;
+    if (name == "combo") return DEVICE_ROLE_COMBO;
+    if (name == "joystick") return DEVICE_ROLE_JOYSTICK;
+    if (name == "touch") return DEVICE_ROLE_TOUCH;
+    return DEVICE_ROLE_NONE;
+}
+
+#ifdef __linux__
+
+// Capabilities of one /dev/input/event* node, read from sysfs.
+struct InputDeviceInfo {
+    std::string path;
+    std::string name;
+    InputDeviceRole role = DEVICE_ROLE_NONE;
+
+    unsigned long ev[NBITS(EV_CNT)] = {};
+    unsigned long key[NBITS(PH_KEY_CNT)] = {};
+    unsigned long rel[NBITS(REL_CNT)] = {};
+    unsigned long abs[NBITS(ABS_CNT)] = {};
+    unsigned long props[NBITS(INPUT_PROP_CNT)] = {};
+
+    bool has_ev(int bit) const { return IS_SET(bit, ev); }
+    bool has_key(int bit) const { return IS_SET(bit, key); }
+    bool has_rel(int bit) const { return IS_SET(bit, rel); }
+    bool has_abs(int bit) const { return IS_SET(bit, abs); }
+    bool has_prop(int bit) const { return IS_SET(bit, props); }
+};
+
+// Classifies input devices from /sys/class/input without opening any device node,
+// the same way udev's input_id builtin does.
+class InputDeviceScanner {
+public:
+    static std::vector<InputDeviceInfo> scan(const char *sysfs_dir = "/sys/class/input") {
+        std::vector<InputDeviceInfo> devices;
+
+        DIR *dir = opendir(sysfs_dir);
+        if (!dir) return devices;
+
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (strncmp(entry->d_name, "event", 5) != 0) continue;
+
+            InputDeviceInfo info;
+            info.path = std::string("/dev/input/") + entry->d_name;
+
+            std::string base = std::string(sysfs_dir) + "/" + entry->d_name + "/device/";
+            if (!read_bitmap((base + "capabilities/ev").c_str(), info.ev, NBITS(EV_CNT))) continue;
+            read_bitmap((base + "capabilities/key").c_str(), info.key, NBITS(PH_KEY_CNT));
+            read_bitmap((base + "capabilities/rel").c_str(), info.rel, NBITS(REL_CNT));
+            read_bitmap((base + "capabilities/abs").c_str(), info.abs, NBITS(ABS_CNT));
+            read_bitmap((base + "properties").c_str(), info.props, NBITS(INPUT_PROP_CNT));
+            info.name = read_line((base + "name").c_str());
+
+            info.role = classify(info);
+            devices.push_back(info);
+        }
+        closedir(dir);
+
+        return devices;
+    }
+
+    // Capabilities a typical device of `role` has, for sources that aren't real
+    // device nodes and so can't be asked.
+    static InputDeviceInfo declare(const std::string &path, const std::string &name, InputDeviceRole role) {
+        InputDeviceInfo info;
+        info.path = path;
+        info.name = name;
+        info.role = role;
+        set_bit(info.ev, EV_SYN);
+
+        if (role == DEVICE_ROLE_KEYBOARD || role == DEVICE_ROLE_COMBO) {
+            set_bit(info.ev, EV_KEY);
+            for (int code = PH_KEY_ESC; code < BTN_MISC; code++) set_bit(info.key, code);
+        }
+        if (role == DEVICE_ROLE_POINTER || role == DEVICE_ROLE_COMBO) {
+            set_bit(info.ev, EV_KEY);
+            set_bit(info.ev, EV_REL);
+            for (int code = BTN_LEFT; code <= BTN_TASK; code++) set_bit(info.key, code);
+            set_bit(info.rel, REL_X);
+            set_bit(info.rel, REL_Y);
+            set_bit(info.rel, REL_WHEEL);
+        }
+        if (role == DEVICE_ROLE_JOYSTICK) {
+            set_bit(info.ev, EV_KEY);
+            set_bit(info.ev, EV_ABS);
+            for (int code = BTN_SOUTH; code <= BTN_THUMBR; code++) set_bit(info.key, code);
+            for (int code : { ABS_X, ABS_Y, ABS_Z, ABS_RX, ABS_RY, ABS_RZ, ABS_HAT0X, ABS_HAT0Y }) set_bit(info.abs, code);
+        }
+        return info;
+    }
+
+    static InputDeviceRole classify(const InputDeviceInfo &info) {
+        bool keyboard = is_keyboard(info);
+
+        // Gaming keyboards often expose REL axes on the key interface without any mouse buttons.
+        if (keyboard && (has_relative_motion(info) || is_absolute_pointer(info))) return DEVICE_ROLE_COMBO;
+        if (keyboard) return DEVICE_ROLE_KEYBOARD;
+        if (is_relative_pointer(info) || is_absolute_pointer(info)) return DEVICE_ROLE_POINTER;
+        if (is_touchscreen(info)) return DEVICE_ROLE_TOUCH;
+        if (is_joystick(info)) return DEVICE_ROLE_JOYSTICK;
+        return DEVICE_ROLE_NONE;
+    }
+
+private:
+    // Full keyboards report every key from KEY_ESC to KEY_S (bits 1-31).
+    static bool is_keyboard(const InputDeviceInfo &info) {
+        if (!info.has_ev(EV_KEY)) return false;
+        for (int code = PH_KEY_ESC; code <= PH_KEY_S; code++) {
+            if (!info.has_key(code)) return false;
+        }
+        return true;
+    }
+
+    static bool has_relative_motion(const InputDeviceInfo &info) {
+        return info.has_ev(EV_REL) && info.has_rel(REL_X) && info.has_rel(REL_Y);
+    }
+
+    static bool is_relative_pointer(const InputDeviceInfo &info) {
+        return has_relative_motion(info) && info.has_key(BTN_LEFT);
+    }
+
+    // Touchpads and pen tablets move the cursor with absolute axes.
+    static bool is_absolute_pointer(const InputDeviceInfo &info) {
+        if (!info.has_ev(EV_ABS) || !info.has_abs(ABS_X) || !info.has_abs(ABS_Y)) return false;
+        if (info.has_prop(INPUT_PROP_DIRECT)) return false;
+        return info.has_key(BTN_TOOL_FINGER) || info.has_key(BTN_TOOL_PEN) || info.has_key(BTN_STYLUS) ||
+            info.has_key(BTN_LEFT);
+    }
+
+    static bool is_touchscreen(const InputDeviceInfo &info) {
+        return info.has_ev(EV_ABS) && info.has_abs(ABS_X) && info.has_abs(ABS_Y) &&
+            info.has_prop(INPUT_PROP_DIRECT) && (info.has_key(BTN_TOUCH) || info.has_key(BTN_TOOL_PEN));
+    }
+
+    static bool is_joystick(const InputDeviceInfo &info) {
+        for (int code = BTN_JOYSTICK; code < BTN_DIGI; code++) {
+            if (info.has_key(code)) return true;
+        }
+        for (int code = BTN_TRIGGER_HAPPY1; code <= BTN_TRIGGER_HAPPY40; code++) {
+            if (info.has_key(code)) return true;
+        }
+        return info.has_ev(EV_ABS) && info.has_abs(ABS_X) && info.has_abs(ABS_Y) &&
+            !info.has_key(BTN_TOUCH) && !info.has_prop(INPUT_PROP_ACCELEROMETER);
+    }
+
+    static void set_bit(unsigned long *bits, int bit) {
+        bits[bit / BITS_PER_LONG] |= 1UL << (bit % BITS_PER_LONG);
+    }
+
+    // sysfs prints the bitmap as space separated hex longs, most significant first.
+    static bool read_bitmap(const char *path, unsigned long *bits, size_t count) {
+        std::string line = read_line(path);
+        if (line.empty()) return false;
+
+        std::vector<unsigned long> words;
+        const char *cursor = line.c_str();
+        while (*cursor) {
+            char *end = nullptr;
+            unsigned long word = strtoul(cursor, &end, 16);
+            if (end == cursor) break;
+            words.push_back(word);
+            cursor = end;
+            while (*cursor == ' ') cursor++;
+        }
+
+        for (size_t i = 0; i < words.size() && i < count; i++) {
+            bits[i] = words[words.size() - 1 - i];
+        }
+        return !words.empty();
+    }
+
+    static std::string read_line(const char *path) {
+        FILE *file = fopen(path, "r");
+        if (!file) return std::string();
+
+        char buffer[1024] = {};
+        if (!fgets(buffer, sizeof(buffer), file)) buffer[0] = '\0';
+        fclose(file);
+
+        size_t len = strlen(buffer);
+        while (len > 0 && (buffer[len - 1] == '\n' || buffer[len - 1] == ' ')) buffer[--len] = '\0';
+        return std::string(buffer);
+    }
+};
+
+#endif
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "../keymaps.h"
+
+#include <stdint.h>
+
+// Filters switch chatter, the press-release-press bursts a worn switch produces
+// within a few milliseconds, out of EV_KEY edges. Tables are sized for every
+// evdev key code up front so filtering never allocates.
+//
+// Eager passes an edge right away and ignores the key for the window after it.
+// An edge it swallowed is put right by flush() once the window expires, so a real
+// tap shorter than the window comes out late rather than lost. Deferred holds an
+// edge until the key was stable for the window, costing that much latency, and
+// drops taps shorter than the window entirely.
+class KeyDebouncer {
+public:
+    enum Mode {
+        MODE_OFF,
+        MODE_EAGER,
+        MODE_DEFERRED,
+    };
+
+    static constexpr int CODE_COUNT = PH_KEY_CNT;
+
+    void set_mode(Mode p_mode) { mode = p_mode; }
+    Mode get_mode() const { return mode; }
+    bool is_enabled() const { return mode != MODE_OFF; }
+
+    // 0 passes the code through unfiltered.
+    void set_window(int code, uint32_t usec) {
+        if (code >= 0 && code < CODE_COUNT) windows[code] = usec;
+    }
+
+    uint64_t get_suppressed() const { return suppressed; }
+    bool has_pending() const { return pending_count > 0; }
+
+    // Returns true if the edge should be applied now.
+    bool filter(int code, bool pressed, uint64_t usec) {
+        if (code < 0 || code >= CODE_COUNT) return true;
+
+        Entry &entry = entries[code];
+        entry.raw = pressed;
+        if (mode == MODE_OFF || windows[code] == 0) {
+            // Kept current so a window set later starts from the real state.
+            entry.reported = pressed;
+            return true;
+        }
+
+        if (mode == MODE_EAGER) {
+            if (usec >= entry.quiet_until) {
+                if (pressed == entry.reported) return true;
+                entry.reported = pressed;
+                entry.quiet_until = usec + windows[code];
+                return true;
+            }
+            suppressed++;
+            add_pending(code);
+            return false;
+        }
+
+        // Deferred: every edge restarts the wait, the one it replaces never shows.
+        if (entry.pending) suppressed++;
+        entry.quiet_until = usec + windows[code];
+        add_pending(code);
+        return false;
+    }
+
+    // Applies what expired by `usec` through emit(code, pressed).
+    template <typename F>
+    void flush(uint64_t usec, F emit) {
+        for (int i = 0; i < pending_count;) {
+            int code = pending[i];
+            Entry &entry = entries[code];
+            if (usec < entry.quiet_until) {
+                i++;
+                continue;
+            }
+
+            if (entry.raw != entry.reported) {
+                // A deferred edge going out as planned, or an eager one swallowed by mistake.
+                if (mode == MODE_EAGER) suppressed--;
+                entry.reported = entry.raw;
+                if (mode == MODE_EAGER) entry.quiet_until = usec + windows[code];
+                emit(code, entry.raw);
+            } else if (mode == MODE_DEFERRED) {
+                suppressed++;
+            }
+
+            entry.pending = false;
+            pending[i] = pending[--pending_count];
+        }
+    }
+
+    // Takes a state read back from the device as both seen and reported, so a
+    // pending edge from before doesn't go out over it.
+    void reset(int code, bool pressed) {
+        if (code < 0 || code >= CODE_COUNT) return;
+        entries[code].raw = pressed;
+        entries[code].reported = pressed;
+    }
+
+    // Applies everything held back, for mode changes and shutdown.
+    template <typename F>
+    void flush_all(F emit) {
+        for (int i = 0; i < pending_count; i++) entries[pending[i]].quiet_until = 0;
+        flush(0, emit);
+    }
+
+    // Earliest time flush() has work, UINT64_MAX when nothing is held.
+    uint64_t next_deadline() const {
+        uint64_t deadline = UINT64_MAX;
+        for (int i = 0; i < pending_count; i++) {
+            uint64_t until = entries[pending[i]].quiet_until;
+            if (until < deadline) deadline = until;
+        }
+        return deadline;
+    }
+
+private:
+    struct Entry {
+        uint64_t quiet_until = 0;
+        bool raw = false;
+        bool reported = false;
+        bool pending = false;
+    };
+
+    Mode mode = MODE_OFF;
+    Entry entries[CODE_COUNT];
+    uint32_t windows[CODE_COUNT] = {};
+    uint16_t pending[CODE_COUNT] = {};
+    int pending_count = 0;
+    uint64_t suppressed = 0;
+
+    void add_pending(int code) {
+        if (entries[code].pending) return;
+        entries[code].pending = true;
+        pending[pending_count++] = (uint16_t)code;
+    }
+};
@@ -0,0 +1,190 @@
+#pragma once
+
+#if defined(__linux__) && defined(GI_USE_IO_URING)
+#include <errno.h>
+#include <linux/input.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Keeps one read posted on every device fd through io_uring, so a burst across
+// N devices costs one wakeup and one submit instead of a poll plus N reads (and
+// N more to find them drained). Completions land in the ring, whose fd polls
+// readable while any are waiting, and are harvested in one pass.
+//
+// Talks to the kernel directly rather than through liburing. Reads are plain
+// IORING_OP_READ re-armed after each completion; multishot reads would need
+// Linux 6.7 and a provided buffer ring, this needs 5.7 for fast poll.
+class UringReader {
+public:
+    static constexpr size_t BUFFER_SIZE = 64 * sizeof(struct input_event);
+
+    ~UringReader() { close(); }
+
+    // False when the kernel has no usable io_uring (too old, disabled by sysctl or
+    // seccomp), with errno describing why.
+    bool open(unsigned entries) {
+        struct io_uring_params params = {};
+        ring_fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+        if (ring_fd < 0) return false;
+
+        // Without fast poll every idle read would park a kernel worker thread.
+        if (!(params.features & IORING_FEAT_FAST_POLL)) {
+            close();
+            errno = ENOTSUP;
+            return false;
+        }
+
+        sq_entries = params.sq_entries;
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) sq_ring_size = cq_ring_size = sq_ring_size > cq_ring_size ? sq_ring_size : cq_ring_size;
+
+        sq_ring = map(sq_ring_size, IORING_OFF_SQ_RING);
+        cq_ring = single_mmap ? sq_ring : map(cq_ring_size, IORING_OFF_CQ_RING);
+        sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+        sqes = (struct io_uring_sqe *)map(sqes_size, IORING_OFF_SQES);
+        if (!sq_ring || !cq_ring || !sqes) {
+            int error = errno;
+            close();
+            errno = error;
+            return false;
+        }
+
+        sq_head = (std::atomic<unsigned> *)(sq_ring + params.sq_off.head);
+        sq_tail = (std::atomic<unsigned> *)(sq_ring + params.sq_off.tail);
+        sq_mask = *(unsigned *)(sq_ring + params.sq_off.ring_mask);
+        sq_array = (unsigned *)(sq_ring + params.sq_off.array);
+        cq_head = (std::atomic<unsigned> *)(cq_ring + params.cq_off.head);
+        cq_tail = (std::atomic<unsigned> *)(cq_ring + params.cq_off.tail);
+        cq_mask = *(unsigned *)(cq_ring + params.cq_off.ring_mask);
+        cqes = (struct io_uring_cqe *)(cq_ring + params.cq_off.cqes);
+        return true;
+    }
+
+    // Closing the ring cancels the reads still posted, do it before closing their fds.
+    void close() {
+        if (sqes) munmap(sqes, sqes_size);
+        if (cq_ring && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+        if (sq_ring) munmap(sq_ring, sq_ring_size);
+        sqes = nullptr;
+        sq_ring = cq_ring = nullptr;
+
+        if (ring_fd >= 0) ::close(ring_fd);
+        ring_fd = -1;
+        slots.clear();
+        queued = 0;
+    }
+
+    int get_fd() const { return ring_fd; }
+
+    bool is_armed(size_t slot) const { return slot < slots.size() && slots[slot] && slots[slot]->armed; }
+
+    // Queues a read of `fd` into the slot's own buffer. Slots are the caller's
+    // device indices and their buffers never move while a read is posted.
+    void arm(size_t slot, int fd) {
+        if (slot >= slots.size()) slots.resize(slot + 1);
+        if (!slots[slot]) slots[slot].reset(new Slot());
+        if (slots[slot]->armed) return;
+
+        unsigned tail = sq_tail->load(std::memory_order_relaxed);
+        if (tail - sq_head->load(std::memory_order_acquire) >= sq_entries) {
+            submit();
+            if (tail - sq_head->load(std::memory_order_acquire) >= sq_entries) return;
+        }
+
+        unsigned index = tail & sq_mask;
+        struct io_uring_sqe *sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)(uintptr_t)slots[slot]->buffer;
+        sqe->len = BUFFER_SIZE;
+        // The file position, so recorded files are read front to back.
+        sqe->off = (uint64_t)-1;
+        sqe->user_data = slot;
+        sq_array[index] = index;
+
+        sq_tail->store(tail + 1, std::memory_order_release);
+        slots[slot]->armed = true;
+        queued++;
+    }
+
+    // Hands everything queued to the kernel in one call, without waiting.
+    void submit() {
+        while (queued > 0) {
+            int ret = (int)syscall(__NR_io_uring_enter, ring_fd, queued, 0, 0, nullptr, 0);
+            if (ret >= 0) {
+                queued -= (unsigned)ret;
+                if (ret == 0) break;
+            } else if (errno != EINTR) {
+                // EBUSY/EAGAIN: completions must be reaped first, the next pass retries.
+                break;
+            }
+        }
+    }
+
+    // Calls done(slot, data, result) for every finished read, result as read()
+    // would return it with errors negated. Returns how many there were.
+    template <typename F>
+    size_t harvest(F done) {
+        unsigned head = cq_head->load(std::memory_order_relaxed);
+        unsigned tail = cq_tail->load(std::memory_order_acquire);
+        size_t count = 0;
+
+        for (; head != tail; head++, count++) {
+            const struct io_uring_cqe &cqe = cqes[head & cq_mask];
+            size_t slot = (size_t)cqe.user_data;
+            int result = cqe.res;
+            // Free the entry before done() may post the next read into the slot.
+            cq_head->store(head + 1, std::memory_order_release);
+            if (slot >= slots.size() || !slots[slot]) continue;
+
+            slots[slot]->armed = false;
+            done(slot, slots[slot]->buffer, result);
+        }
+        return count;
+    }
+
+private:
+    struct Slot {
+        uint8_t buffer[BUFFER_SIZE];
+        bool armed = false;
+    };
+
+    int ring_fd = -1;
+    unsigned sq_entries = 0;
+    unsigned queued = 0;
+
+    uint8_t *sq_ring = nullptr;
+    uint8_t *cq_ring = nullptr;
+    size_t sq_ring_size = 0;
+    size_t cq_ring_size = 0;
+    struct io_uring_sqe *sqes = nullptr;
+    size_t sqes_size = 0;
+
+    std::atomic<unsigned> *sq_head = nullptr;
+    std::atomic<unsigned> *sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned *sq_array = nullptr;
+    std::atomic<unsigned> *cq_head = nullptr;
+    std::atomic<unsigned> *cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    struct io_uring_cqe *cqes = nullptr;
+
+    std::vector<std::unique_ptr<Slot>> slots;
+
+    uint8_t *map(size_t size, off_t offset) {
+        void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+        return memory == MAP_FAILED ? nullptr : (uint8_t *)memory;
+    }
+};
+
+#endif
@@ -1,433 +1,1124 @@
 #pragma once
 
-#include "../common.h"
+#include "../input_hub.h"
+#include "xkb_layout_table.h"
+#include "evdev_joypad.h"
+#include "event_stream_server.h"
+#include "key_debouncer.h"
+#include "uring_reader.h"
 
 #ifdef __linux__
 #include <fcntl.h>
 #include <unistd.h>
 #include <linux/input.h>
 #include <sys/ioctl.h>
-#include <dirent.h>
 #include <string.h>
 #include <poll.h>
-
-#define BITS_PER_LONG (sizeof(long) * 8)
-#define NBITS(x) ((((x)-1)/BITS_PER_LONG)+1)
-#define IS_SET(bit, bits) ((bits[bit/BITS_PER_LONG] & (1UL << (bit % BITS_PER_LONG))) != 0)
+#include <time.h>
+#include <sys/eventfd.h>
 #endif
 
+#include "input_devices.h"
+
 #include <algorithm>
-#include <cctype>
+#include <vector>
 
 using namespace godot;
 
-class LinuxGlobalInput : public GlobalInputCommon {
-private:
+class LinuxInputHub : public InputHub {
+public:
+    LinuxInputHub() {
+        #ifdef __linux__
+        wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        memset(tracked_codes, 0xff, sizeof(tracked_codes));
+        #endif
+    }
 
-    #ifdef __linux__
-    int keyboard_fd = -1;
-    int mice_fd = -1;
+    ~LinuxInputHub() {
+        #ifdef __linux__
+        if (wake_fd >= 0) ::close(wake_fd);
+        #endif
+    }
 
-    int open_keyboard_device() {
-        const char *input_dir = "/dev/input/";
-        DIR *dir = opendir(input_dir);
-        if (!dir) {
-            return -1;
+    void set_keyboard_layout(const String &layout, const String &variant) override {
+        #ifdef __linux__
+        {
+            std::lock_guard<std::mutex> lock(layout_mutex);
+            layout_override.layout = layout.utf8().get_data();
+            layout_override.variant = variant.utf8().get_data();
+            layout_changed = true;
         }
+        // Before READY the table is built by open(), or by on_ready() if open() was past it.
+        if (get_status() == STATUS_READY) refresh_layout_table();
+        #endif
+    }
 
-        struct dirent *entry;
+    bool set_event_stream(const std::string &path) override {
+        #ifdef __linux__
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        if (stream && stream->get_path() == path) return true;
+
+        stream.reset();
+        stream_generation++;
+        if (!path.empty()) {
+            std::unique_ptr<EventStreamServer> server(new EventStreamServer());
+            if (!server->listen(path)) return false;
+            stream = std::move(server);
+        }
+        // The hook thread has to start polling the new listening socket.
+        wake();
+        #endif
+        return true;
+    }
 
-        int best_fd = -1;
-        int best_score = -1;
+    uint64_t get_event_stream_dropped() override {
+        #ifdef __linux__
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        if (stream) return stream->get_dropped();
+        #endif
+        return 0;
+    }
 
-        while ((entry = readdir(dir)) != nullptr) {
-            if (strncmp(entry->d_name, "event", 5) != 0) {
-                continue;
-            }
+    void set_debounce(int mode, int msec) override {
+        #ifdef __linux__
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        KeyDebouncer::Mode wanted = mode == GlobalInputCommon::DEBOUNCE_DEFERRED
+            ? KeyDebouncer::MODE_DEFERRED : KeyDebouncer::MODE_EAGER;
+        debounce_msec = msec > 0 ? msec : 0;
+        // Flushes what the old mode held before switching.
+        rebuild_debounce_windows();
+        debouncer.set_mode(wanted);
+        wake();
+        #endif
+    }
+
+    // A negative window goes back to the global one.
+    void set_key_debounce(int key, int msec) override {
+        #ifdef __linux__
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        if (msec < 0) key_debounce_msec.erase(key);
+        else key_debounce_msec[key] = msec;
+        rebuild_debounce_windows();
+        #endif
+    }
+
+    int physical_code_for(int key) const override {
+        auto it = physical_codes.find(key);
+        return it != physical_codes.end() ? it->second : -1;
+    }
+
+    uint64_t get_debounce_suppressed() override {
+        #ifdef __linux__
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        return debouncer.get_suppressed();
+        #endif
+        return 0;
+    }
+
+    // Sources that aren't device nodes (FIFOs, socketpairs, files of recorded
+    // input_event records) read as devices with the capabilities of `role`.
+    struct VirtualDeviceSpec {
+        std::string path;
+        std::string name;
+        InputDeviceRole role = DEVICE_ROLE_NONE;
+    };
+
+    // Each view declares its own, like tracked keys. Declared before the hub opens
+    // they are opened with the other devices, after that right away. Removing a
+    // view's declarations keeps later starts from opening them, devices already
+    // open stay until they end or the hub closes.
+    bool declare_virtual_device(const void *view, const VirtualDeviceSpec &spec) {
+        bool opened;
+        {
+            std::lock_guard<std::recursive_mutex> lock(state_mutex);
+            std::vector<VirtualDeviceSpec> &specs = view_virtual_devices[view];
+            auto it = std::find_if(specs.begin(), specs.end(),
+                [&](const VirtualDeviceSpec &existing) { return existing.path == spec.path; });
+            if (it != specs.end()) *it = spec;
+            else specs.push_back(spec);
+            opened = virtual_devices_opened;
+        }
+        return !opened || open_virtual_device(spec);
+    }
+
+    void remove_virtual_devices(const void *view) {
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        view_virtual_devices.erase(view);
+    }
+
+    // Takes ownership of `fd`. A path that is already open keeps its device.
+    bool add_virtual_device(int fd, const VirtualDeviceSpec &spec) {
+        #ifdef __linux__
+        if (fd < 0) return false;
+        if (has_virtual_device(spec.path)) {
+            ::close(fd);
+            return true;
+        }
+
+        EvdevDevice device;
+        device.fd = fd;
+        device.info = InputDeviceScanner::declare(spec.path, spec.name.empty() ? spec.path : spec.name, spec.role);
+        device.is_virtual = true;
+        // Axis ranges of a typical gamepad, since there is no driver to ask.
+        for (int code : { ABS_X, ABS_Y, ABS_RX, ABS_RY }) set_abs_range(device, code, -32768, 32767);
+        for (int code : { ABS_Z, ABS_RZ }) set_abs_range(device, code, 0, 255);
+        for (int code : { ABS_HAT0X, ABS_HAT0Y }) set_abs_range(device, code, -1, 1);
+
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        // Opened by another thread meanwhile.
+        if (has_virtual_device(spec.path)) {
+            ::close(fd);
+            return true;
+        }
+        if (spec.role == DEVICE_ROLE_JOYSTICK) open_joypad(device);
+        devices.push_back(device);
+        wake();
+        return true;
+        #else
+        return false;
+        #endif
+    }
+
+    bool open_virtual_device(const VirtualDeviceSpec &spec) {
+        #ifdef __linux__
+        if (has_virtual_device(spec.path)) return true;
+
+        // Opened without the lock, a FIFO or socket path may take a moment.
+        int fd = ::open(spec.path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            godot::print_line("Global Input: Failed to open virtual device " + String(spec.path.c_str()));
+            return false;
+        }
+        return add_virtual_device(fd, spec);
+        #else
+        return false;
+        #endif
+    }
+
+    // Whether open() would find a device it may read, without keeping any open.
+    // Independent of the display server, so it decides backend auto-selection.
+    static bool can_read_devices() {
+        #ifdef __linux__
+        for (const InputDeviceInfo &info : InputDeviceScanner::scan()) {
+            if (!wants_device(info.role)) continue;
+
+            int fd = ::open(info.path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+            if (fd < 0) continue;
+            ::close(fd);
+            return true;
+        }
+        #endif
+        return false;
+    }
+
+    Array get_devices() override {
+        Array result;
+        #ifdef __linux__
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        for (const EvdevDevice &device : devices) {
+            Dictionary entry;
+            entry["path"] = String(device.info.path.c_str());
+            entry["name"] = String(device.info.name.c_str());
+            entry["role"] = String(input_device_role_name(device.info.role));
+            if (device.pad >= 0) entry["joypad"] = device.pad;
+            if (device.is_virtual) entry["virtual"] = true;
+            result.push_back(entry);
+        }
+        #endif
+        return result;
+    }
+
+    #ifdef __linux__
+    // Also used by the XInput2 backend, whose raw keycodes are evdev codes offset by 8.
+    static uint32_t modifier_bit(int code) {
+        switch (code) {
+            case PH_KEY_LEFTSHIFT: return GlobalInputCommon::MODIFIER_LEFT_SHIFT;
+            case PH_KEY_RIGHTSHIFT: return GlobalInputCommon::MODIFIER_RIGHT_SHIFT;
+            case PH_KEY_LEFTCTRL: return GlobalInputCommon::MODIFIER_LEFT_CTRL;
+            case PH_KEY_RIGHTCTRL: return GlobalInputCommon::MODIFIER_RIGHT_CTRL;
+            case PH_KEY_LEFTALT: return GlobalInputCommon::MODIFIER_LEFT_ALT;
+            case PH_KEY_RIGHTALT: return GlobalInputCommon::MODIFIER_RIGHT_ALT;
+            case PH_KEY_LEFTMETA: return GlobalInputCommon::MODIFIER_LEFT_META;
+            case PH_KEY_RIGHTMETA: return GlobalInputCommon::MODIFIER_RIGHT_META;
+            default: return 0;
+        }
+    }
+    #endif
 
-            char path[512];
-            snprintf(path, sizeof(path), "%s%s", input_dir, entry->d_name);
+protected:
+    bool open() override {
+        #ifdef __linux__
+        // Everything slow happens without state_mutex, so an async start never
+        // blocks the main thread's queries on xkb or device ioctls.
+        refresh_layout_table();
+
+        std::unordered_map<int, int> codes;
+        for (const auto &[code, key] : key_map) {
+            auto it = codes.find(key);
+            if (it == codes.end() || code < it->second) codes[key] = code;
+        }
 
-            int fd = open(path, O_RDONLY | O_NONBLOCK);
+        // Classify from sysfs first, so only the devices we keep are ever opened.
+        std::vector<EvdevDevice> opened;
+        for (const InputDeviceInfo &info : InputDeviceScanner::scan()) {
+            if (!wants_device(info.role)) continue;
+
+            int fd = ::open(info.path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
             if (fd < 0) {
+                godot::print_line("Global Input: Failed to open " + String(info.path.c_str()));
                 continue;
             }
 
-            unsigned long evbit[NBITS(EV_CNT)] = {};
-            unsigned long keybit[256] = {};
-            unsigned long relbit[NBITS(REL_CNT)] = {};
+            godot::print_line("Global Input: Opened " + String(input_device_role_name(info.role)) +
+                " device: " + String(info.name.c_str()));
+
+            EvdevDevice device;
+            device.fd = fd;
+            device.info = info;
+            if (info.has_ev(EV_ABS)) read_abs_ranges(device);
+            // Event times on the steady clock, comparable with MotionEstimator::now_usec().
+            // Without it they stay on CLOCK_REALTIME and edges are stamped when read.
+            int clock = CLOCK_MONOTONIC;
+            device.steady_times = ioctl(fd, EVIOCSCLOCKID, &clock) == 0;
+            // Tablets and touchpads without REL axes report where on the surface they
+            // are. Tablets map it onto the desktop, touchpads move the cursor like a mouse.
+            bool surface = info.role != DEVICE_ROLE_JOYSTICK && info.has_abs(ABS_X) &&
+                info.has_abs(ABS_Y) && !info.has_rel(REL_X);
+            device.touchpad = surface && info.has_key(BTN_TOOL_FINGER) && !info.has_key(BTN_TOOL_PEN) &&
+                !info.has_key(BTN_STYLUS);
+            device.absolute_pointer = surface && !device.touchpad;
+            opened.push_back(device);
+        }
 
-            if (ioctl(fd, EVIOCGBIT(0, sizeof(evbit)), evbit) < 0) {
-                close(fd);
-                continue;
+        {
+            // add_virtual_device() may push to `devices` from another thread during an async start.
+            std::lock_guard<std::recursive_mutex> lock(state_mutex);
+            physical_codes = std::move(codes);
+            for (EvdevDevice &device : opened) {
+                if (device.info.role == DEVICE_ROLE_JOYSTICK) open_joypad(device);
+                devices.push_back(device);
             }
+            // Keys tracked before the devices were open.
+            apply_tracked_keys();
+        }
 
-            if (!IS_SET(EV_KEY, evbit)) {
-                close(fd);
-                continue;
-            }
+        // Declarations from here on open their device themselves.
+        std::vector<VirtualDeviceSpec> declared;
+        {
+            std::lock_guard<std::recursive_mutex> lock(state_mutex);
+            for (const auto &[view, specs] : view_virtual_devices) declared.insert(declared.end(), specs.begin(), specs.end());
+            virtual_devices_opened = true;
+        }
+        for (const VirtualDeviceSpec &spec : declared) open_virtual_device(spec);
 
-            bool has_relative_motion = false;
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        if (!devices.empty()) return true;
 
-            if (IS_SET(EV_REL, evbit)) {
-                if (ioctl(fd, EVIOCGBIT(EV_REL, sizeof(relbit)), relbit) >= 0) {
-                    if (IS_SET(REL_X, relbit) || IS_SET(REL_Y, relbit)) {
-                        has_relative_motion = true;
-                    }
-                }
-            }
+        godot::print_line("Global Input: No readable input devices, is the user in the input group?");
+        #endif
+        return false;
+    }
 
-            if (has_relative_motion) {
-                close(fd);
-                continue;
-            }
+    void close() override {
+        #ifdef __linux__
+        // add_virtual_device() pushes to `devices` from other threads.
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        #ifdef GI_USE_IO_URING
+        // Cancels the posted reads before their fds go away.
+        uring.reset();
+        #endif
+        for (EvdevDevice &device : devices) {
+            if (device.fd >= 0) ::close(device.fd);
+        }
+        devices.clear();
+        joy_pads = 0;
+        stream.reset();
+        #endif
+    }
 
-            char name[256] = {};
-            ioctl(fd, EVIOCGNAME(sizeof(name)), name);
+    void run() override {
+    #ifdef __linux__
+        // Devices first so fds[i] lines up with devices[i], then the wake eventfd,
+        // then the event stream sockets. Rebuilt every pass since clients come and go.
+        std::vector<struct pollfd> fds;
+        #ifdef GI_USE_IO_URING
+        // Created here so the hook thread is the one the kernel completes reads for.
+        start_uring();
+        #endif
 
-            std::string name_str(name);
+        // Blocks until a device is readable or wake() is called, idle costs no wakeups.
+        while (running) {
+            size_t device_count = 0;
+            size_t stream_first = 0;
+            int timeout = -1;
+            uint64_t polled_stream = 0;
+            {
+                // Virtual devices and stream servers are added from other threads.
+                std::lock_guard<std::recursive_mutex> lock(state_mutex);
+                fds.clear();
+                if (reading_through_uring()) {
+                    // The ring stands in for every device.
+                    arm_uring_reads(fds);
+                } else {
+                    for (const EvdevDevice &device : devices) {
+                        struct pollfd entry = {};
+                        entry.fd = device.fd;
+                        entry.events = POLLIN;
+                        fds.push_back(entry);
+                    }
+                }
+                device_count = fds.size();
 
-            std::transform(
-                name_str.begin(),
-                name_str.end(),
-                name_str.begin(),
-                [](unsigned char c) { return std::tolower(c); });
+                struct pollfd wake_poll = {};
+                wake_poll.fd = wake_fd;
+                wake_poll.events = POLLIN;
+                fds.push_back(wake_poll);
 
-            int score = 0;
+                stream_first = fds.size();
+                if (stream) {
+                    stream->add_poll_fds(fds);
+                    polled_stream = stream_generation;
+                }
 
-            if (name_str.find("keyboard") != std::string::npos) {
-                score += 1000;
+                // Only held back debounce edges need a timeout, idle still never wakes.
+                uint64_t deadline = debouncer.next_deadline();
+                if (deadline != UINT64_MAX) {
+                    uint64_t now = MotionEstimator::now_usec();
+                    timeout = deadline > now ? (int)((deadline - now + 999) / 1000) : 0;
+                }
             }
 
-            if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keybit)), keybit) >= 0) {
-                int score = 0;
+            int ret = poll(fds.data(), fds.size(), timeout);
+            wakeups++;
+            if (ret < 0) continue;
 
-                for (size_t word = 0; word < sizeof(keybit) / sizeof(keybit[0]); ++word) {
-                    score += __builtin_popcountl(keybit[word]);
-                }
+            if (fds[device_count].revents & POLLIN) {
+                uint64_t count;
+                while (read(wake_fd, &count, sizeof(count)) > 0) {}
             }
 
-            if (score > best_score) {
-                if (best_fd >= 0) {
-                    close(best_fd);
+            std::lock_guard<std::recursive_mutex> lock(state_mutex);
+            if (reading_through_uring()) {
+                if (fds[0].revents & POLLIN) harvest_uring_reads();
+            } else {
+                for (size_t i = 0; i < device_count; i++) {
+                    // Drain first, a FIFO whose writer left reports POLLHUP with data still queued.
+                    bool open = !(fds[i].revents & POLLIN) || read_device(devices[i]);
+                    if (open && !(fds[i].revents & (POLLERR | POLLHUP | POLLNVAL))) continue;
+
+                    // poll skips negative fds from now on.
+                    close_device(devices[i]);
                 }
+            }
+            if (debouncer.has_pending()) flush_debounced(MotionEstimator::now_usec());
+            publish_pointer();
 
-                best_fd = fd;
-                best_score = score;
-            } else {
-                close(fd);
+            if (stream) {
+                // Sockets from a server replaced since the poll are stale.
+                if (polled_stream == stream_generation) stream->service(fds.data() + stream_first, fds.size() - stream_first);
+                stream->flush();
             }
         }
+    #endif
+    }
 
-        closedir(dir);
+    // A layout set while the hub was starting, after open() had built the table.
+    void on_ready() override {
+        #ifdef __linux__
+        bool changed;
+        {
+            std::lock_guard<std::mutex> lock(layout_mutex);
+            changed = layout_changed;
+        }
+        if (changed) refresh_layout_table();
+        #endif
+    }
 
-        if (best_fd >= 0) {
-            print_line(
-                "Global Input: Opened keyboard device with score: " +
-                String::num(best_score));
+    void on_edge(const SharedInputEvent &event) override {
+        #ifdef __linux__
+        if (stream) stream->push(event);
+        #endif
+    }
+
+    // Rebuilds the code bitmap from the tracked Godot keys, by layout and by
+    // position, and hands it to the kernel for every device it filters for.
+    // Only codes that map to an untracked key are masked; codes no map knows
+    // stay readable through is_scancode_pressed().
+    void apply_tracked_keys() override {
+        #ifdef __linux__
+        for (int code = 0; code < PH_KEY_CNT; code++) {
+            auto physical = key_map.find(code);
+            int layout_key = layout_table.lookup(code);
+            int physical_key = physical != key_map.end() ? physical->second : 0;
+            bool tracked = tracked_keys.empty() || code >= BTN_MISC || modifier_bit(code) != 0 ||
+                (layout_key == 0 && physical_key == 0) ||
+                (layout_key != 0 && is_key_tracked(layout_key)) ||
+                (physical_key != 0 && is_key_tracked(physical_key));
+
+            uint64_t bit = (uint64_t)1 << (code % 64);
+            tracked_codes[code / 64] = tracked ? (tracked_codes[code / 64] | bit) : (tracked_codes[code / 64] & ~bit);
+            if (!tracked && is_physical_code_pressed(code)) apply_key(code, false);
         }
 
-        return best_fd;
+        for (const EvdevDevice &device : devices) {
+            if (device.fd >= 0 && !device.is_virtual) set_event_masks(device);
+        }
+        #endif
     }
-    #endif
 
-public:
-    LinuxGlobalInput(){}
-    
-    ~LinuxGlobalInput(){
-        stop();
+    void wake() override {
+        #ifdef __linux__
+        if (wake_fd < 0) return;
+        uint64_t one = 1;
+        ssize_t written = write(wake_fd, &one, sizeof(one));
+        (void)written;
+        #endif
     }
 
-    void start() override {
-        if (running) return;
-        if (!OS::get_singleton()) { running = false; return; }
-        if (OS::get_singleton()->has_feature("editor_hint")){ running = false; return; }
+private:
 
-        key_state.clear();
-        key_just_pressed_frame.clear();
-        key_just_released_frame.clear();
-        mouse_state.clear();
-        mouse_just_pressed_frame.clear();
-        mouse_just_released_frame.clear();
+    #ifdef __linux__
+    struct EvdevDevice {
+        int fd = -1;
+        InputDeviceInfo info;
+
+        // Axis ranges reported by the driver.
+        struct input_absinfo abs_info[ABS_CNT] = {};
+
+        int pad = -1;
+        bool absolute_pointer = false;
+        bool touchpad = false;
+
+        // Motion of the report in progress, applied on SYN_REPORT.
+        double pending_x = 0.0;
+        double pending_y = 0.0;
+        bool moved = false;
+        bool dropping = false;
+        // Cursor before an absolute report moved it.
+        Vector2 report_start;
+
+        // Touchpad finger, the last position per axis is only valid while anchored.
+        bool touching = false;
+        bool touch_anchored[2] = {};
+        int touch_last[2] = {};
+
+        // Whether event times are on the steady clock.
+        bool steady_times = false;
+
+        // Pipes and sockets may split a record across reads.
+        bool is_virtual = false;
+        uint8_t partial[sizeof(struct input_event)] = {};
+        size_t partial_length = 0;
+
+        // Reads posted through io_uring need a blocking fd, or the kernel answers
+        // EAGAIN instead of waiting for data.
+        bool blocking = false;
+
+        // Key codes this device reported down, released when it goes away.
+        uint64_t held[(PH_KEY_CNT + 63) / 64] = {};
+    };
+
+    std::vector<EvdevDevice> devices;
+    int wake_fd = -1;
+
+    std::unique_ptr<EventStreamServer> stream;
+    uint64_t stream_generation = 0;
+
+    #ifdef GI_USE_IO_URING
+    // Null when the kernel refused io_uring, devices are then polled one by one.
+    std::unique_ptr<UringReader> uring;
+    static constexpr unsigned URING_ENTRIES = 64;
+    #endif
 
-        key_maps->get_platform_key_mapping(key_map);
+    // EV_KEY codes of tracked keys, in the bitmap layout EVIOCSMASK takes.
+    uint64_t tracked_codes[(PH_KEY_CNT + 63) / 64];
+    bool event_masks_failed = false;
 
-        #ifdef __linux__
-        keyboard_fd = open_keyboard_device();
-        if (keyboard_fd < 0) godot::print_line("Failed to open keyboard device.");
+    // Godot key -> evdev code from the built in US map, which is what Godot's
+    // physical keycodes are named after. The lowest code wins for keys on both sides.
+    std::unordered_map<int, int> physical_codes;
+    static_assert(PH_KEY_CNT <= PHYSICAL_CODE_COUNT, "every evdev key code needs a physical bit");
 
-        mice_fd = open("/dev/input/mice", O_RDONLY | O_NONBLOCK);
-        if (mice_fd < 0) godot::print_line("Failed to open mouse device /dev/input/mice.");
+    KeyDebouncer debouncer;
+    int debounce_msec = 0;
+    std::unordered_map<int, int> key_debounce_msec; // by Godot key
 
-        if (keyboard_fd >= 0 || mice_fd >= 0) {
-            running = true;
-            hook_thread = std::thread(&LinuxGlobalInput::poll_input, this);
-        }
-        else{
-            godot::print_line("Something went wrong. UGHHHH WORK I BEG YOU.");
+    std::mutex layout_mutex;
+    XkbLayoutTable layout_table;
+    XkbLayoutTable pending_table;
+    XkbLayoutNames layout_override;
+    bool layout_changed = false;
+
+    std::unordered_map<const void *, std::vector<VirtualDeviceSpec>> view_virtual_devices;
+    bool virtual_devices_opened = false;
+
+    bool has_virtual_device(const std::string &path) {
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        for (const EvdevDevice &device : devices) {
+            if (device.is_virtual && device.fd >= 0 && device.info.path == path) return true;
         }
-        #endif
+        return false;
     }
 
-    void stop() override{
-        if (!running) return;
-        running = false;
-        if (hook_thread.joinable())
-            hook_thread.join();
+    static void set_abs_range(EvdevDevice &device, int code, int minimum, int maximum) {
+        device.abs_info[code].minimum = minimum;
+        device.abs_info[code].maximum = maximum;
+    }
 
-        #ifdef __linux__
-        if (keyboard_fd >= 0) {
-            close(keyboard_fd);
-            keyboard_fd = -1;
-        }
-        if (mice_fd >= 0) {
-            close(mice_fd);
-            mice_fd = -1;
+    static bool wants_device(InputDeviceRole role) {
+        return role == DEVICE_ROLE_KEYBOARD || role == DEVICE_ROLE_POINTER || role == DEVICE_ROLE_COMBO ||
+            role == DEVICE_ROLE_JOYSTICK;
+    }
+
+    // Ranges are read once here, the hook thread only rescales.
+    static void read_abs_ranges(EvdevDevice &device) {
+        for (int code = 0; code < ABS_CNT; code++) {
+            if (!device.info.has_abs(code)) continue;
+            if (ioctl(device.fd, EVIOCGABS(code), &device.abs_info[code]) < 0) {
+                memset(&device.abs_info[code], 0, sizeof(device.abs_info[code]));
+            }
         }
-        #endif
     }
 
-    void poll_data() override {
-        for (auto &it : key_just_pressed_frame) { if (it.second == 0) it.second = current_frame; }
-        for (auto &it : key_just_released_frame) { if (it.second == 0) it.second = current_frame; }
-        for (auto &it : mouse_just_pressed_frame) { if (it.second == 0) it.second = current_frame; }
-        for (auto &it : mouse_just_released_frame) { if (it.second == 0) it.second = current_frame; }
+    void open_joypad(EvdevDevice &device) {
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        device.pad = joy_pads++;
     }
 
-    void increment_frame() override{
-        current_frame++;    
+    // Explicit layout from set_keyboard_layout wins over the detected system one.
+    // The table is compiled outside state_mutex so queries never wait on xkb.
+    void refresh_layout_table() {
+        std::lock_guard<std::mutex> layout_lock(layout_mutex);
+        layout_changed = false;
+        XkbLayoutNames wanted = layout_override.layout.empty()
+            ? XkbLayoutTable::detect_system_layout()
+            : layout_override;
+
+        if (!pending_table.rebuild_if_changed(wanted, key_map)) return;
+
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        layout_table = pending_table;
+        rebuild_debounce_windows();
+        if (!tracked_keys.empty()) apply_tracked_keys();
     }
 
-    bool is_key_pressed(int key) override{
-        auto it = key_state.find(key);
-        return it != key_state.end() && it->second;
+    bool is_code_tracked(int code) const {
+        if (code < 0 || code >= PH_KEY_CNT) return true;
+        return (tracked_codes[code / 64] >> (code % 64)) & 1;
     }
 
-    bool is_key_just_pressed(int key) override{
-        auto it = key_just_pressed_frame.find(key);
-        return it != key_just_pressed_frame.end() && it->second != 0 && (current_frame - it->second) <= JUST_BUFFER_FRAMES;
+    // The kernel drops untracked keys and scan codes before they are queued, and
+    // skips the SYN_REPORT of a report that ends up empty, so they never wake poll().
+    // Joypads keep every button since some report KEY_* codes.
+    void set_event_masks(const EvdevDevice &device) {
+        uint64_t no_codes[(MSC_CNT + 63) / 64] = {};
+        struct input_mask key_mask = { EV_KEY, sizeof(tracked_codes), (uint64_t)(uintptr_t)tracked_codes };
+        struct input_mask msc_mask = { EV_MSC, sizeof(no_codes), (uint64_t)(uintptr_t)no_codes };
+
+        bool ok = ioctl(device.fd, EVIOCSMASK, &msc_mask) == 0;
+        if (ok && device.pad < 0) ok = ioctl(device.fd, EVIOCSMASK, &key_mask) == 0;
+        if (ok || event_masks_failed) return;
+
+        // Before Linux 4.4. process_event() still drops what isn't tracked.
+        event_masks_failed = true;
+        godot::print_line("Global Input: The kernel can't mask input events (" + String(strerror(errno)) +
+            "), untracked keys are filtered on the hook thread.");
     }
 
-    bool is_key_just_released(int key) override{
-        auto it = key_just_released_frame.find(key);
-        return it != key_just_released_frame.end() && it->second != 0 && (current_frame - it->second) <= JUST_BUFFER_FRAMES;
+    // Returns false once the source reached its end.
+    bool read_device(EvdevDevice &device) {
+        uint8_t buffer[64 * sizeof(struct input_event)];
+        ssize_t bytes;
+        while ((bytes = read(device.fd, buffer, sizeof(buffer))) > 0) process_bytes(device, buffer, (size_t)bytes);
+        return bytes != 0;
     }
 
-    bool is_mouse_pressed(int button) override{
-        auto it = mouse_state.find(button);
-        return it != mouse_state.end() && it->second;
+    // Decodes whole records and keeps a trailing partial one for the next read.
+    void process_bytes(EvdevDevice &device, const uint8_t *data, size_t size) {
+        size_t used = 0;
+        if (device.partial_length > 0) {
+            used = std::min(sizeof(struct input_event) - device.partial_length, size);
+            memcpy(device.partial + device.partial_length, data, used);
+            device.partial_length += used;
+            if (device.partial_length < sizeof(struct input_event)) return;
+
+            process_record(device, device.partial);
+            device.partial_length = 0;
+        }
+
+        for (; size - used >= sizeof(struct input_event); used += sizeof(struct input_event)) {
+            process_record(device, data + used);
+        }
+
+        device.partial_length = size - used;
+        memcpy(device.partial, data + used, device.partial_length);
     }
-    
-    bool is_mouse_just_pressed(int button) override{
-        auto it = mouse_just_pressed_frame.find(button);
-        return it != mouse_just_pressed_frame.end() && it->second != 0 && (current_frame - it->second) <= JUST_BUFFER_FRAMES;
+
+    void process_record(EvdevDevice &device, const uint8_t *record) {
+        struct input_event ev;
+        memcpy(&ev, record, sizeof(ev));
+        // Injected records' times and times on another clock can't be compared, 0 stamps them now.
+        event_time_usec = device.steady_times ? (uint64_t)ev.input_event_sec * 1000000 + (uint64_t)ev.input_event_usec : 0;
+        if (device.pad >= 0) process_joypad_event(device, ev);
+        else process_event(device, ev);
     }
 
-    bool is_mouse_just_released(int button) override{
-        auto it = mouse_just_released_frame.find(button);
-        return it != mouse_just_released_frame.end() && it->second != 0 && (current_frame - it->second) <= JUST_BUFFER_FRAMES;
+    bool reading_through_uring() const {
+        #ifdef GI_USE_IO_URING
+        return uring != nullptr;
+        #else
+        return false;
+        #endif
     }
 
-    Vector2 get_mouse_position() override{
-        return mouse_position;
+    #ifdef GI_USE_IO_URING
+    void start_uring() {
+        std::unique_ptr<UringReader> reader(new UringReader());
+        if (!reader->open(URING_ENTRIES)) {
+            godot::print_line("Global Input: io_uring is unavailable (" + String(strerror(errno)) +
+                "), reading devices through poll.");
+            return;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        uring = std::move(reader);
     }
+    #endif
 
-    bool is_action_pressed(const String &action) override{
-        if (!InputMap::get_singleton()) return false;
-        const Array events = InputMap::get_singleton()->action_get_events(action);
-        for (int i = 0; i < events.size(); i++) {
-            Ref<InputEvent> ev = events[i];
-            if (!ev.is_valid()) continue;
-            if (auto *key_ev = Object::cast_to<InputEventKey>(ev.ptr())) {
-                if (!modifiers_match(key_ev)) continue; 
-                if (key_state[key_ev->get_keycode()]) return true;
-            } else if (auto *mouse_ev = Object::cast_to<InputEventMouseButton>(ev.ptr())) {
-                if (!modifiers_match(mouse_ev)) continue; 
-                if (mouse_state[mouse_ev->get_button_index()]) return true;
+    // Posts a read for every device without one, including devices added since the
+    // last pass, and adds the ring to the poll set.
+    void arm_uring_reads(std::vector<struct pollfd> &fds) {
+        #ifdef GI_USE_IO_URING
+        for (size_t i = 0; i < devices.size(); i++) {
+            EvdevDevice &device = devices[i];
+            if (device.fd < 0 || uring->is_armed(i)) continue;
+
+            if (!device.blocking) {
+                fcntl(device.fd, F_SETFL, fcntl(device.fd, F_GETFL) & ~O_NONBLOCK);
+                device.blocking = true;
             }
+            uring->arm(i, device.fd);
         }
-        return false;
+        uring->submit();
+
+        struct pollfd entry = {};
+        entry.fd = uring->get_fd();
+        entry.events = POLLIN;
+        fds.push_back(entry);
+        #endif
     }
 
-    bool is_action_just_pressed(const String &action) override{
-        if (!InputMap::get_singleton()) return false;
-        const Array events = InputMap::get_singleton()->action_get_events(action);
-        for (int i = 0; i < events.size(); i++) {
-            Ref<InputEvent> ev = events[i];
-            if (!ev.is_valid()) continue;
-            if (auto *key_ev = Object::cast_to<InputEventKey>(ev.ptr())) {
-                auto it = key_just_pressed_frame.find(key_ev->get_keycode());
-                if (!modifiers_match(key_ev)) continue; 
-                if (it != key_just_pressed_frame.end() && it->second != 0 && (current_frame - it->second) <= JUST_BUFFER_FRAMES) return true;
-            } else if (auto *mouse_ev = Object::cast_to<InputEventMouseButton>(ev.ptr())) {
-                auto it = mouse_just_pressed_frame.find(mouse_ev->get_button_index());
-                if (!modifiers_match(mouse_ev)) continue; 
-                if (it != mouse_just_pressed_frame.end() && it->second != 0 && (current_frame - it->second) <= JUST_BUFFER_FRAMES) return true;
+    // Every finished read is decoded and posted again in the same pass, and the
+    // new reads go out in one submit.
+    void harvest_uring_reads() {
+        #ifdef GI_USE_IO_URING
+        uring->harvest([this](size_t slot, const uint8_t *data, int result) {
+            if (slot >= devices.size()) return;
+            EvdevDevice &device = devices[slot];
+
+            if (result > 0) {
+                process_bytes(device, data, (size_t)result);
+                uring->arm(slot, device.fd);
+            } else if (result == -EINTR || result == -EAGAIN) {
+                uring->arm(slot, device.fd);
+            } else {
+                close_device(device);
             }
-        }
-        return false;
+        });
+        uring->submit();
+        #endif
     }
 
-    bool is_action_just_released(const String &action) override{
-        if (!InputMap::get_singleton()) return false;
-        const Array events = InputMap::get_singleton()->action_get_events(action);
-        for (int i = 0; i < events.size(); i++) {
-            Ref<InputEvent> ev = events[i];
-            if (!ev.is_valid()) continue;
-            if (auto *key_ev = Object::cast_to<InputEventKey>(ev.ptr())) {
-                auto it = key_just_released_frame.find(key_ev->get_keycode());
-                if (!modifiers_match(key_ev)) continue; 
-                if (it != key_just_released_frame.end() && (current_frame - it->second) <= 1) return true;
-            } else if (auto *mouse_ev = Object::cast_to<InputEventMouseButton>(ev.ptr())) {
-                auto it = mouse_just_released_frame.find(mouse_ev->get_button_index());
-                if (!modifiers_match(mouse_ev)) continue; 
-                if (it != mouse_just_released_frame.end() && (current_frame - it->second) <= 1) return true;
+    void process_event(EvdevDevice &device, const struct input_event &ev) {
+        // After an overflow the kernel wants everything up to the next report
+        // ignored, and the state read back from the device after it.
+        if (device.dropping) {
+            if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+                device.dropping = false;
+                resync_keys(device);
             }
+            return;
+        }
+
+        switch (ev.type) {
+            case EV_KEY: {
+                // Virtual devices and kernels without event masks still deliver everything.
+                if (!is_code_tracked(ev.code)) break;
+
+                // Autorepeat (value 2) changes no state, it is only counted.
+                if (ev.value == 2) {
+                    int godot_key = layout_table.lookup(ev.code);
+                    if (godot_key != 0) repeat_key(godot_key);
+                    break;
+                }
+                set_held(device, ev.code, ev.value != 0);
+
+                // Pen lifted off the surface, or a finger put down or lifted off a touchpad.
+                if (ev.code == BTN_TOUCH && ev.value == 0) pen_pressure = 0.0f;
+                if (ev.code == BTN_TOUCH && device.touchpad) set_touching(device, ev.value != 0);
+
+                if (debouncer.is_enabled()) {
+                    uint64_t usec = edge_time();
+                    // Expired holds go first so edges stay in order.
+                    if (debouncer.has_pending()) flush_debounced(usec);
+                    if (!debouncer.filter(ev.code, ev.value != 0, usec)) break;
+                }
+                apply_key(ev.code, ev.value != 0);
+                break;
+            }
+            case EV_REL:
+                if (ev.code == REL_X) {
+                    device.pending_x += ev.value;
+                    device.moved = true;
+                } else if (ev.code == REL_Y) {
+                    device.pending_y += ev.value;
+                    device.moved = true;
+                } else if (ev.code == REL_WHEEL) {
+                    wheel_delta += ev.value;
+                }
+                break;
+            case EV_SYN:
+                if (ev.code == SYN_REPORT) flush_motion(device);
+                else if (ev.code == SYN_DROPPED) {
+                    device.pending_x = device.pending_y = 0;
+                    device.moved = false;
+                    device.touch_anchored[0] = device.touch_anchored[1] = false;
+                    device.dropping = true;
+                }
+                break;
+            case EV_ABS:
+                if (device.absolute_pointer) {
+                    if ((ev.code == ABS_X || ev.code == ABS_Y) && !device.moved) {
+                        device.report_start = mouse_position;
+                        device.moved = true;
+                    }
+                    process_absolute_pointer(device, ev);
+                } else if (device.touchpad) {
+                    process_touchpad(device, ev);
+                }
+                break;
+            default:
+                break;
         }
-        return false;
     }
-    
-    // Debug Returns
 
-    Dictionary get_keys_pressed_detailed() override{
-        Dictionary dict;
-        for (const auto &[key, down] : key_state) {
-            if (!down) continue;
-            String name = "Unknown";
-            if (OS::get_singleton() && key >= 0 && key <= KEY_MENU)
-                name = OS::get_singleton()->get_keycode_string((Key)key);
-            dict[name] = true;
-            dict["os"] = "Linux or BSD";
+    // Sets every key and button the device has to what it reports holding now,
+    // so an edge lost in an overflow doesn't leave one stuck. Virtual devices
+    // have nobody to ask and never overflow.
+    void resync_keys(EvdevDevice &device) {
+        if (device.is_virtual) return;
+        uint8_t held[(PH_KEY_CNT + 7) / 8] = {};
+        if (ioctl(device.fd, EVIOCGKEY(sizeof(held)), held) < 0) return;
+
+        event_time_usec = 0;
+        for (int code = 0; code < PH_KEY_CNT; code++) {
+            if (!device.info.has_key(code) || !is_code_tracked(code)) continue;
+            bool down = (held[code / 8] >> (code % 8)) & 1;
+            set_held(device, code, down);
+            if (code == BTN_TOUCH && device.touchpad) set_touching(device, down);
+            if (down == is_physical_code_pressed(code)) continue;
+            debouncer.reset(code, down);
+            apply_key(code, down);
         }
-        return dict;
     }
 
-    Dictionary get_keys_just_pressed_detailed() override{
-        Dictionary dict;
-        for (const auto &[key, frame] : key_just_pressed_frame) {
-            if ((current_frame - frame) > 1) continue;
-            String name = "Unknown";
-            if (OS::get_singleton() && key >= 0 && key <= KEY_MENU)
-                name = OS::get_singleton()->get_keycode_string((Key)key);
-            dict[name] = true;
-            dict["os"] = "Linux or BSD";
+    static void set_held(EvdevDevice &device, int code, bool down) {
+        if (code < 0 || code >= PH_KEY_CNT) return;
+        uint64_t bit = (uint64_t)1 << (code % 64);
+        device.held[code / 64] = down ? (device.held[code / 64] | bit) : (device.held[code / 64] & ~bit);
+    }
+
+    static bool is_held(const EvdevDevice &device, int code) {
+        return (device.held[code / 64] >> (code % 64)) & 1;
+    }
+
+    // Unplugged, or the end of a FIFO or recorded file. Nothing would ever release
+    // what a real device was holding, so that is released here; a virtual device's
+    // last state stays. Keys another open device still holds stay down.
+    void close_device(EvdevDevice &device) {
+        ::close(device.fd);
+        device.fd = -1;
+        if (device.is_virtual) return;
+
+        event_time_usec = 0;
+        if (device.pad >= 0) {
+            release_joypad(device.pad);
+            return;
         }
-        return dict;
+
+        for (int code = 0; code < PH_KEY_CNT; code++) {
+            if (!is_held(device, code)) continue;
+            set_held(device, code, false);
+
+            bool elsewhere = false;
+            for (const EvdevDevice &other : devices) elsewhere = elsewhere || (other.fd >= 0 && is_held(other, code));
+            if (elsewhere) continue;
+
+            debouncer.reset(code, false);
+            if (is_physical_code_pressed(code)) apply_key(code, false);
+        }
+        if (device.absolute_pointer) pen_pressure = 0.0f;
     }
 
-    Dictionary get_keys_just_released_detailed() override{
-        Dictionary dict;
-        for (const auto &[key, frame] : key_just_released_frame) {
-            if ((current_frame - frame) > 1) continue;
-            String name = "Unknown";
-            if (OS::get_singleton() && key >= 0 && key <= KEY_MENU)
-                name = OS::get_singleton()->get_keycode_string((Key)key);
-            dict[name] = true;
-            dict["os"] = "Linux or BSD";
+    // Buttons up and axes centered, including the virtual buttons axes drive.
+    void release_joypad(int pad) {
+        std::vector<int> buttons;
+        std::vector<int> axes;
+        for (const auto &[code, down] : joy_state) {
+            if (down && code / JOY_CODES_PER_PAD == pad) buttons.push_back(code % JOY_CODES_PER_PAD);
         }
-        return dict;
+        for (const auto &[code, value] : joy_axis) {
+            if (value != 0.0f && code / JOY_CODES_PER_PAD == pad) axes.push_back(code % JOY_CODES_PER_PAD);
+        }
+        for (int axis : axes) set_joy_axis(pad, axis, 0.0f);
+        for (int button : buttons) set_joy_button(pad, button, false);
     }
 
-    // Modifiers
-    bool is_alt_pressed() override{
-        #ifdef __linux__
-        return is_key_pressed(PH_KEY_LEFTALT) || is_key_pressed(PH_KEY_RIGHTALT);
-        #endif
-        return false;
+    void apply_key(int code, bool pressed) {
+        set_physical_key(code, pressed);
+
+        uint32_t modifier = modifier_bit(code);
+        if (modifier != 0) {
+            set_modifier(modifier, pressed);
+            return;
+        }
+
+        int button = mouse_button_for(code);
+        if (button != 0) {
+            set_mouse_button(button, pressed);
+            return;
+        }
+
+        int godot_key = layout_table.lookup(code);
+        if (godot_key != 0) set_key(godot_key, pressed);
     }
 
-    bool is_ctrl_pressed() override{
-        #ifdef __linux__
-        return is_key_pressed(PH_KEY_LEFTCTRL) || is_key_pressed(PH_KEY_RIGHTCTRL);
-        #endif
-        return false;
+    // Released edges are stamped with the time they go out.
+    void flush_debounced(uint64_t usec) {
+        event_time_usec = usec;
+        debouncer.flush(usec, [this](int code, bool pressed) { apply_key(code, pressed); });
     }
 
-    bool is_shift_pressed() override{
-        #ifdef __linux__
-        return is_key_pressed(PH_KEY_LEFTSHIFT) || is_key_pressed(PH_KEY_RIGHTSHIFT);
-        #endif
-        return false;
+    // Per-key windows are set by Godot key, so they follow the layout. Held edges
+    // go out under the windows they were held with, and every entry restarts from
+    // the applied state, which it may have missed while its window was 0.
+    void rebuild_debounce_windows() {
+        debouncer.flush_all([this](int code, bool pressed) { apply_key(code, pressed); });
+        for (int code = 0; code < KeyDebouncer::CODE_COUNT; code++) {
+            debouncer.reset(code, is_physical_code_pressed(code));
+            auto it = key_debounce_msec.find(layout_table.lookup(code));
+            int msec = it != key_debounce_msec.end() ? it->second : debounce_msec;
+            debouncer.set_window(code, (uint32_t)msec * 1000);
+        }
     }
 
-    bool is_meta_pressed() override{
-        #ifdef __linux__
-        return is_key_pressed(PH_KEY_LEFTMETA) || is_key_pressed(PH_KEY_RIGHTMETA);
-        #endif
-        return false;
+    // A report's motion is applied once however many REL events it carried, which
+    // keeps 8 kHz mice to one clamp and one estimator update per report.
+    void flush_motion(EvdevDevice &device) {
+        if (!device.moved) return;
+        device.moved = false;
+        uint64_t usec = event_time_usec != 0 ? event_time_usec : MotionEstimator::now_usec();
+
+        if (device.absolute_pointer) {
+            // The report already placed the cursor, only its motion is left to count.
+            Vector2 delta = mouse_position - device.report_start;
+            if (delta != Vector2()) {
+                motion.add(delta.x, delta.y);
+                motion.report(usec);
+            }
+        } else if (device.pending_x != 0 || device.pending_y != 0) {
+            move_mouse(Vector2(device.pending_x, device.pending_y));
+            motion.add(device.pending_x, device.pending_y);
+            motion.report(usec);
+            device.pending_x = device.pending_y = 0;
+        }
+        record_path_sample();
     }
-    
-    void handle_input(const Ref<InputEvent> &event) override {}
 
-    void poll_input() {
-    #ifdef __linux__
-        struct pollfd fds[2];
+    // Travel starts over from wherever the finger lands.
+    static void set_touching(EvdevDevice &device, bool touching) {
+        device.touching = touching;
+        device.touch_anchored[0] = device.touch_anchored[1] = false;
+    }
 
-        while (running) {
-            fds[0].fd = keyboard_fd;
-            fds[0].events = POLLIN;
-            fds[0].revents = 0;
+    // The finger's travel while it touches becomes relative motion, so the cursor
+    // doesn't jump to the finger's place on the pad.
+    void process_touchpad(EvdevDevice &device, const struct input_event &ev) {
+        if (ev.code != ABS_X && ev.code != ABS_Y) return;
+        int axis = ev.code == ABS_X ? 0 : 1;
+
+        if (device.touching && device.touch_anchored[axis]) {
+            double delta = (ev.value - device.touch_last[axis]) * touchpad_scale(device.abs_info[ev.code]);
+            if (axis == 0) device.pending_x += delta;
+            else device.pending_y += delta;
+            device.moved = true;
+        }
+        device.touch_last[axis] = ev.value;
+        device.touch_anchored[axis] = device.touching;
+    }
 
-            fds[1].fd = mice_fd;
-            fds[1].events = POLLIN;
-            fds[1].revents = 0;
+    // Pad units to pixels at 1000 dpi, what libinput normalizes pointer motion to.
+    // Pads that don't report a resolution are taken to be 100 mm across.
+    static double touchpad_scale(const struct input_absinfo &range) {
+        double units_per_mm = range.resolution > 0 ? range.resolution : (range.maximum - range.minimum) / 100.0;
+        return units_per_mm > 0.0 ? 1000.0 / 25.4 / units_per_mm : 1.0;
+    }
 
-            int ret = poll(fds, 2, 5);
+    // The device surface maps onto the whole desktop, like an absolute-mode tablet.
+    void process_absolute_pointer(const EvdevDevice &device, const struct input_event &ev) {
+        const struct input_absinfo &range = device.abs_info[ev.code];
+
+        switch (ev.code) {
+            case ABS_X:
+                mouse_position.x = screen_rect.has_area()
+                    ? screen_rect.position.x + abs_unit(range, ev.value) * (screen_rect.size.x - 1)
+                    : ev.value;
+                break;
+            case ABS_Y:
+                mouse_position.y = screen_rect.has_area()
+                    ? screen_rect.position.y + abs_unit(range, ev.value) * (screen_rect.size.y - 1)
+                    : ev.value;
+                break;
+            case ABS_PRESSURE:
+                pen_pressure = abs_unit(range, ev.value);
+                break;
+            case ABS_TILT_X:
+                pen_tilt.x = abs_unit(range, ev.value) * 2.0f - 1.0f;
+                break;
+            case ABS_TILT_Y:
+                pen_tilt.y = abs_unit(range, ev.value) * 2.0f - 1.0f;
+                break;
+            default:
+                break;
+        }
+    }
 
-            if (ret > 0) {
-                std::lock_guard<std::recursive_mutex> lock(state_mutex);
-                if (keyboard_fd >= 0 && (fds[0].revents & POLLIN)) {
-                    struct input_event ev;
+    static float abs_unit(const struct input_absinfo &range, int value) {
+        if (range.maximum <= range.minimum) return 0.0f;
+        float unit = (float)(value - range.minimum) / (float)(range.maximum - range.minimum);
+        return std::fmin(std::fmax(unit, 0.0f), 1.0f);
+    }
 
-                    while (read(keyboard_fd, &ev, sizeof(ev)) == sizeof(ev)) {
-                        if (ev.type != EV_KEY)
-                            continue;
+    void process_joypad_event(EvdevDevice &device, const struct input_event &ev) {
+        if (device.dropping) {
+            if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+                device.dropping = false;
+                resync_joypad(device);
+            }
+            return;
+        }
 
-                        auto it = key_map.find((int)ev.code);
-                        if (it == key_map.end())
-                            continue;
+        switch (ev.type) {
+            case EV_KEY: {
+                int button = EvdevJoypad::button_for(ev.code);
+                if (button >= 0) set_joy_button(device.pad, button, ev.value != 0);
+                break;
+            }
+            case EV_ABS:
+                apply_joypad_abs(device, ev.code, ev.value);
+                break;
+            case EV_SYN:
+                if (ev.code == SYN_DROPPED) device.dropping = true;
+                break;
+            default:
+                break;
+        }
+    }
 
-                        int godot_key = it->second;
-                        bool pressed = (ev.value != 0);
+    void apply_joypad_abs(const EvdevDevice &device, int code, int value) {
+        // Hats are the d-pad on most HID gamepads.
+        if (code == ABS_HAT0X) {
+            set_joy_button(device.pad, JOY_BUTTON_DPAD_LEFT, value < 0);
+            set_joy_button(device.pad, JOY_BUTTON_DPAD_RIGHT, value > 0);
+            return;
+        }
+        if (code == ABS_HAT0Y) {
+            set_joy_button(device.pad, JOY_BUTTON_DPAD_UP, value < 0);
+            set_joy_button(device.pad, JOY_BUTTON_DPAD_DOWN, value > 0);
+            return;
+        }
 
-                        bool was_pressed = key_state[godot_key];
-                        key_state[godot_key] = pressed;
+        int axis = EvdevJoypad::axis_for(code);
+        if (axis < 0) return;
+        set_joy_axis(device.pad, axis, EvdevJoypad::normalize(device.abs_info[code], value, axis, joy_deadzone));
+    }
 
-                        if (pressed && !was_pressed)
-                            key_just_pressed_frame[godot_key] = 0;
+    // Buttons and axes read back from the pad after an overflow. Buttons and
+    // axes that didn't change are no-ops in the hub.
+    void resync_joypad(EvdevDevice &device) {
+        if (device.is_virtual) return;
+        event_time_usec = 0;
+
+        uint8_t held[(PH_KEY_CNT + 7) / 8] = {};
+        if (ioctl(device.fd, EVIOCGKEY(sizeof(held)), held) == 0) {
+            for (int code = 0; code < PH_KEY_CNT; code++) {
+                int button = device.info.has_key(code) ? EvdevJoypad::button_for(code) : -1;
+                if (button >= 0) set_joy_button(device.pad, button, (held[code / 8] >> (code % 8)) & 1);
+            }
+        }
 
-                        if (!pressed && was_pressed)
-                            key_just_released_frame[godot_key] = 0;
-                    }
-                }
-                
-                if (mice_fd >= 0 && (fds[1].revents & POLLIN)) {
-                    unsigned char data[3];
+        for (int code = 0; code < ABS_CNT; code++) {
+            if (!device.info.has_abs(code)) continue;
+            if (ioctl(device.fd, EVIOCGABS(code), &device.abs_info[code]) < 0) continue;
+            apply_joypad_abs(device, code, device.abs_info[code].value);
+        }
+    }
+
+    static int mouse_button_for(int code) {
+        switch (code) {
+            case BTN_LEFT: return MOUSE_BUTTON_LEFT;
+            case BTN_RIGHT: return MOUSE_BUTTON_RIGHT;
+            case BTN_MIDDLE: return MOUSE_BUTTON_MIDDLE;
+            case BTN_SIDE: return MOUSE_BUTTON_XBUTTON1;
+            case BTN_EXTRA: return MOUSE_BUTTON_XBUTTON2;
+            default: return 0;
+        }
+    }
+    #endif
+};
 
-                    if (read(mice_fd, data, sizeof(data)) == sizeof(data)) {
-                        bool left_pressed   = (data[0] & 0x1) != 0;
-                        bool right_pressed  = (data[0] & 0x2) != 0;
-                        bool middle_pressed = (data[0] & 0x4) != 0;
+class LinuxGlobalInput : public HubInputView {
+public:
+    LinuxGlobalInput(){}
+    // The base destructor's stop() can't reach the override.
+    ~LinuxGlobalInput() { stop(); }
 
-                        update_mouse_state(MOUSE_BUTTON_LEFT, left_pressed);
-                        update_mouse_state(MOUSE_BUTTON_RIGHT, right_pressed);
-                        update_mouse_state(MOUSE_BUTTON_MIDDLE, middle_pressed);
+    void stop() override {
+        if (hub) static_cast<LinuxInputHub *>(hub)->remove_virtual_devices(this);
+        HubInputView::stop();
+    }
 
-                        mouse_position.x += (signed char)data[1];
-                        mouse_position.y += (signed char)data[2];
-                    }
-                }
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(8));
+    // Kept for every later start of this node as well as opened on a running hub.
+    bool add_virtual_device(const String &path, const String &role, const String &name) override {
+        #ifdef __linux__
+        LinuxInputHub::VirtualDeviceSpec spec;
+        spec.path = path.utf8().get_data();
+        spec.name = name.utf8().get_data();
+        spec.role = input_device_role_from_name(role.utf8().get_data());
+        if (spec.role == DEVICE_ROLE_NONE || spec.role == DEVICE_ROLE_TOUCH) {
+            godot::print_line("Global Input: Unknown virtual device role " + role);
+            return false;
         }
-    #endif
+
+        auto it = std::find_if(virtual_devices.begin(), virtual_devices.end(),
+            [&](const LinuxInputHub::VirtualDeviceSpec &existing) { return existing.path == spec.path; });
+        if (it != virtual_devices.end()) *it = spec;
+        else virtual_devices.push_back(spec);
+
+        if (hub) return static_cast<LinuxInputHub *>(hub)->declare_virtual_device(this, spec);
+        return true;
+        #endif
+        return false;
     }
 
-private:
-    void update_mouse_state(int button, bool is_pressed = true) {
-        bool was_pressed = mouse_state[button];
-        mouse_state[button] = is_pressed;
-        if (is_pressed && !was_pressed) mouse_just_pressed_frame[button] = 0;
-        if (!is_pressed && was_pressed) mouse_just_released_frame[button] = 0;
+protected:
+    InputHub *acquire_hub(bool async) override {
+        return InputHub::acquire<LinuxInputHub>(async, [this](LinuxInputHub *linux_hub) {
+            for (const LinuxInputHub::VirtualDeviceSpec &spec : virtual_devices) linux_hub->declare_virtual_device(this, spec);
+        });
     }
-};
\ No newline at end of file
+    const char *os_name() const override { return "Linux or BSD"; }
+
+private:
+    std::vector<LinuxInputHub::VirtualDeviceSpec> virtual_devices;
+};
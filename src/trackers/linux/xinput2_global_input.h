@@ -0,0 +1,338 @@
+#pragma once
+
+#include "x11_global_input.h"
+
+#if defined(__linux__) && defined(GI_USE_XINPUT2)
+#include <X11/Xlib.h>
+#include <X11/extensions/XInput2.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+using namespace godot;
+
+// Reads XInput2 raw events the X server sends to the root window, so unlike the
+// evdev backend it needs no access to /dev/input. Raw keycodes are evdev codes
+// offset by 8, so keys go through the same layout table and physical codes.
+// Under XWayland the server only sees input while an X client has focus.
+class XInput2InputHub : public InputHub {
+public:
+    XInput2InputHub() {
+        #if defined(__linux__) && defined(GI_USE_XINPUT2)
+        wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        #endif
+    }
+
+    ~XInput2InputHub() {
+        #if defined(__linux__) && defined(GI_USE_XINPUT2)
+        if (wake_fd >= 0) ::close(wake_fd);
+        #endif
+    }
+
+    // Whether an X server with XInput 2 is reachable, for backend auto-selection.
+    static bool is_available() {
+        #if defined(__linux__) && defined(GI_USE_XINPUT2)
+        Display *probe = XOpenDisplay(nullptr);
+        if (!probe) return false;
+        int opcode;
+        bool available = query_xinput2(probe, opcode);
+        XCloseDisplay(probe);
+        return available;
+        #else
+        return false;
+        #endif
+    }
+
+    void set_keyboard_layout(const String &layout, const String &variant) override {
+        #if defined(__linux__) && defined(GI_USE_XINPUT2)
+        {
+            std::lock_guard<std::mutex> lock(layout_mutex);
+            layout_override.layout = layout.utf8().get_data();
+            layout_override.variant = variant.utf8().get_data();
+            layout_changed = true;
+        }
+        // Before READY the table is built by open(), or by on_ready() if open() was past it.
+        if (get_status() == STATUS_READY) refresh_layout_table();
+        #endif
+    }
+
+    int physical_code_for(int key) const override {
+        auto it = physical_codes.find(key);
+        return it != physical_codes.end() ? it->second : -1;
+    }
+
+    // The X server merges every device into its master pointer and keyboard.
+    Array get_devices() override {
+        Array result;
+        #if defined(__linux__) && defined(GI_USE_XINPUT2)
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        if (!display) return result;
+
+        Dictionary entry;
+        entry["path"] = String(DisplayString(display));
+        entry["name"] = String("XInput2 master devices");
+        entry["role"] = String(input_device_role_name(DEVICE_ROLE_COMBO));
+        result.push_back(entry);
+        #endif
+        return result;
+    }
+
+protected:
+    bool open() override {
+        #if defined(__linux__) && defined(GI_USE_XINPUT2)
+        // A connection of our own, only ever used by one thread at a time.
+        display = XOpenDisplay(nullptr);
+        if (!display) {
+            godot::print_line("Global Input: Failed to open the X display.");
+            return false;
+        }
+        if (!query_xinput2(display, xi_opcode)) {
+            godot::print_line("Global Input: The X server has no XInput 2.");
+            XCloseDisplay(display);
+            display = nullptr;
+            return false;
+        }
+
+        unsigned char bits[XIMaskLen(XI_LASTEVENT)] = {};
+        XISetMask(bits, XI_RawKeyPress);
+        XISetMask(bits, XI_RawKeyRelease);
+        XISetMask(bits, XI_RawButtonPress);
+        XISetMask(bits, XI_RawButtonRelease);
+        XISetMask(bits, XI_RawMotion);
+        XIEventMask mask = { XIAllMasterDevices, (int)sizeof(bits), bits };
+        XISelectEvents(display, DefaultRootWindow(display), &mask, 1);
+        XFlush(display);
+
+        // Before state_mutex, refresh_layout_table() takes layout_mutex first.
+        refresh_layout_table();
+
+        std::unordered_map<int, int> codes;
+        for (const auto &[code, key] : key_map) {
+            auto it = codes.find(key);
+            if (it == codes.end() || code < it->second) codes[key] = code;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        physical_codes = std::move(codes);
+        query_pointer();
+        return true;
+        #else
+        return false;
+        #endif
+    }
+
+    void close() override {
+        #if defined(__linux__) && defined(GI_USE_XINPUT2)
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        if (display) XCloseDisplay(display);
+        display = nullptr;
+        #endif
+    }
+
+    // A layout set while the hub was starting, after open() had built the table.
+    void on_ready() override {
+        #if defined(__linux__) && defined(GI_USE_XINPUT2)
+        bool changed;
+        {
+            std::lock_guard<std::mutex> lock(layout_mutex);
+            changed = layout_changed;
+        }
+        if (changed) refresh_layout_table();
+        #endif
+    }
+
+    void run() override {
+    #if defined(__linux__) && defined(GI_USE_XINPUT2)
+        int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        for (int fd : { ConnectionNumber(display), wake_fd }) {
+            struct epoll_event entry = {};
+            entry.events = EPOLLIN;
+            entry.data.fd = fd;
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &entry);
+        }
+
+        struct epoll_event ready[2];
+        while (running) {
+            // Xlib may have queued events while reading replies, the socket won't signal those.
+            if (XPending(display) == 0) {
+                int count = epoll_wait(epoll_fd, ready, 2, correction_timeout());
+                wakeups++;
+                for (int i = 0; i < count; i++) {
+                    if (ready[i].data.fd != wake_fd) continue;
+                    uint64_t value;
+                    while (read(wake_fd, &value, sizeof(value)) > 0) {}
+                }
+            }
+
+            std::lock_guard<std::recursive_mutex> lock(state_mutex);
+            while (XPending(display) > 0) {
+                XEvent event;
+                XNextEvent(display, &event);
+
+                XGenericEventCookie *cookie = &event.xcookie;
+                if (cookie->type != GenericEvent || cookie->extension != xi_opcode) continue;
+                if (!XGetEventData(display, cookie)) continue;
+                process_raw_event(cookie->evtype, (const XIRawEvent *)cookie->data);
+                XFreeEventData(display, cookie);
+            }
+
+            if (pointer_stale && MotionEstimator::now_usec() >= next_correction_usec) query_pointer();
+            publish_pointer();
+        }
+
+        ::close(epoll_fd);
+    #endif
+    }
+
+    void wake() override {
+        #if defined(__linux__) && defined(GI_USE_XINPUT2)
+        if (wake_fd < 0) return;
+        uint64_t one = 1;
+        ssize_t written = write(wake_fd, &one, sizeof(one));
+        (void)written;
+        #endif
+    }
+
+private:
+    // Godot key -> evdev code, as in the evdev backend.
+    std::unordered_map<int, int> physical_codes;
+
+    #if defined(__linux__) && defined(GI_USE_XINPUT2)
+    static constexpr int EVDEV_KEYCODE_OFFSET = 8;
+    // Raw motion is unaccelerated, so the cursor estimate drifts from the real one.
+    // It is put right by XQueryPointer at most this often, and once motion stops.
+    static constexpr uint64_t POINTER_CORRECTION_USEC = 50000;
+
+    Display *display = nullptr;
+    int xi_opcode = 0;
+    int wake_fd = -1;
+
+    bool pointer_stale = false;
+    uint64_t next_correction_usec = 0;
+
+    std::mutex layout_mutex;
+    XkbLayoutTable layout_table;
+    XkbLayoutTable pending_table;
+    XkbLayoutNames layout_override;
+    bool layout_changed = false;
+
+    static bool query_xinput2(Display *target, int &opcode) {
+        int event_base, error_base;
+        if (!XQueryExtension(target, "XInputExtension", &opcode, &event_base, &error_base)) return false;
+
+        // 2.1 delivers raw events to the root window even while another client grabs.
+        int major = 2, minor = 1;
+        return XIQueryVersion(target, &major, &minor) == Success && major >= 2;
+    }
+
+    void refresh_layout_table() {
+        std::lock_guard<std::mutex> layout_lock(layout_mutex);
+        layout_changed = false;
+        XkbLayoutNames wanted = layout_override.layout.empty()
+            ? XkbLayoutTable::detect_system_layout()
+            : layout_override;
+
+        if (!pending_table.rebuild_if_changed(wanted, key_map)) return;
+
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        layout_table = pending_table;
+    }
+
+    void process_raw_event(int type, const XIRawEvent *raw) {
+        switch (type) {
+            case XI_RawKeyPress:
+            case XI_RawKeyRelease:
+                apply_key(raw->detail - EVDEV_KEYCODE_OFFSET, type == XI_RawKeyPress);
+                break;
+            case XI_RawButtonPress:
+            case XI_RawButtonRelease:
+                apply_button(raw->detail, type == XI_RawButtonPress);
+                break;
+            case XI_RawMotion:
+                apply_motion(raw);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void apply_key(int code, bool pressed) {
+        if (code < 0 || code >= PH_KEY_CNT) return;
+
+        uint32_t modifier = LinuxInputHub::modifier_bit(code);
+        int godot_key = modifier != 0 ? GlobalInputCommon::modifier_key(modifier) : layout_table.lookup(code);
+
+        // A press of a held key is the server's autorepeat.
+        if (pressed && is_physical_code_pressed(code)) {
+            if (godot_key != 0) repeat_key(godot_key);
+            return;
+        }
+
+        set_physical_key(code, pressed);
+        if (modifier != 0) set_modifier(modifier, pressed);
+        else if (godot_key != 0 && is_key_tracked(godot_key)) set_key(godot_key, pressed);
+    }
+
+    // Core protocol numbering: 4-7 are scroll steps, 8 and 9 back and forward.
+    void apply_button(int button, bool pressed) {
+        switch (button) {
+            case 1: set_mouse_button(MOUSE_BUTTON_LEFT, pressed); break;
+            case 2: set_mouse_button(MOUSE_BUTTON_MIDDLE, pressed); break;
+            case 3: set_mouse_button(MOUSE_BUTTON_RIGHT, pressed); break;
+            case 4: if (pressed) wheel_delta++; break;
+            case 5: if (pressed) wheel_delta--; break;
+            case 8: set_mouse_button(MOUSE_BUTTON_XBUTTON1, pressed); break;
+            case 9: set_mouse_button(MOUSE_BUTTON_XBUTTON2, pressed); break;
+            default: break;
+        }
+    }
+
+    // raw_values holds one entry per valuator set in the mask, X and Y are 0 and 1.
+    // Absolute devices report positions here, the correction covers those.
+    void apply_motion(const XIRawEvent *raw) {
+        double delta[2] = {};
+        const double *value = raw->raw_values;
+        for (int axis = 0; axis < raw->valuators.mask_len * 8; axis++) {
+            if (!XIMaskIsSet(raw->valuators.mask, axis)) continue;
+            if (axis < 2) delta[axis] = *value;
+            value++;
+        }
+        if (delta[0] == 0.0 && delta[1] == 0.0) return;
+
+        move_mouse(Vector2(delta[0], delta[1]));
+        motion.add(delta[0], delta[1]);
+        motion.report(MotionEstimator::now_usec());
+        record_path_sample();
+        pointer_stale = true;
+    }
+
+    void query_pointer() {
+        Window root, child;
+        int root_x, root_y, window_x, window_y;
+        unsigned int buttons;
+        if (XQueryPointer(display, DefaultRootWindow(display), &root, &child, &root_x, &root_y,
+                &window_x, &window_y, &buttons)) {
+            mouse_position = Vector2(root_x, root_y);
+        }
+        pointer_stale = false;
+        next_correction_usec = MotionEstimator::now_usec() + POINTER_CORRECTION_USEC;
+    }
+
+    // Idle waits block, a stale cursor waits only until it may be corrected.
+    int correction_timeout() const {
+        if (!pointer_stale) return -1;
+        uint64_t now = MotionEstimator::now_usec();
+        return next_correction_usec > now ? (int)((next_correction_usec - now + 999) / 1000) : 0;
+    }
+    #endif
+};
+
+class XInput2GlobalInput : public HubInputView {
+public:
+    XInput2GlobalInput(){}
+
+protected:
+    InputHub *acquire_hub(bool async) override { return InputHub::acquire<XInput2InputHub>(async); }
+    const char *os_name() const override { return "Linux or BSD"; }
+};
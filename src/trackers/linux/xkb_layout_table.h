@@ -0,0 +1,243 @@
+#pragma once
+
+#include "../keymaps.h"
+
+#ifdef __linux__
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef GI_USE_XKBCOMMON
+#include <xkbcommon/xkbcommon.h>
+#endif
+#endif
+
+#include <string>
+#include <unordered_map>
+
+using namespace godot;
+
+// RMLVO names describing a keyboard layout. Empty fields fall back to the
+// libxkbcommon defaults (which also honour the XKB_DEFAULT_* variables).
+struct XkbLayoutNames {
+    std::string rules;
+    std::string model;
+    std::string layout;
+    std::string variant;
+    std::string options;
+
+    bool operator==(const XkbLayoutNames &other) const {
+        return rules == other.rules && model == other.model && layout == other.layout &&
+            variant == other.variant && options == other.options;
+    }
+    bool operator!=(const XkbLayoutNames &other) const { return !(*this == other); }
+};
+
+// Flat evdev code -> Godot key table for the active layout.
+// Built once per layout change, so the hook thread only pays an array lookup per event.
+class XkbLayoutTable {
+public:
+    #ifdef __linux__
+    static constexpr int TABLE_SIZE = PH_KEY_CNT;
+    #else
+    static constexpr int TABLE_SIZE = 1;
+    #endif
+
+    XkbLayoutTable() { memset(table, 0, sizeof(table)); }
+
+    int lookup(int code) const {
+        return (unsigned)code < (unsigned)TABLE_SIZE ? table[code] : 0;
+    }
+
+    const XkbLayoutNames &get_names() const { return names; }
+
+    // Rebuilds the table when `p_names` differs from the layout it was last built for.
+    // Codes the layout can't express (non latin keysyms, unknown keys) use `fallback`.
+    bool rebuild_if_changed(const XkbLayoutNames &p_names, const std::unordered_map<int, int> &fallback) {
+        if (built && p_names == names) return false;
+
+        int next[TABLE_SIZE] = {};
+        for (const auto &[code, godot_key] : fallback) {
+            if (code >= 0 && code < TABLE_SIZE) next[code] = godot_key;
+        }
+
+        #if defined(__linux__) && defined(GI_USE_XKBCOMMON)
+        if (!compile_layout(p_names, next)) {
+            print_line("Global Input: Failed to compile xkb layout, using US-QWERTY mapping.");
+        }
+        #endif
+
+        memcpy(table, next, sizeof(table));
+        names = p_names;
+        built = true;
+        return true;
+    }
+
+    // Reads the system layout without talking to a display server.
+    // XKB_DEFAULT_* variables override /etc/default/keyboard and systemd-localed's X11 config.
+    static XkbLayoutNames detect_system_layout() {
+        XkbLayoutNames detected;
+
+        #ifdef __linux__
+        read_keyboard_defaults("/etc/default/keyboard", detected);
+        read_xorg_keyboard_conf("/etc/X11/xorg.conf.d/00-keyboard.conf", detected);
+
+        const char *env;
+        if ((env = getenv("XKB_DEFAULT_RULES")) && *env) detected.rules = env;
+        if ((env = getenv("XKB_DEFAULT_MODEL")) && *env) detected.model = env;
+        if ((env = getenv("XKB_DEFAULT_LAYOUT")) && *env) detected.layout = env;
+        if ((env = getenv("XKB_DEFAULT_VARIANT")) && *env) detected.variant = env;
+        if ((env = getenv("XKB_DEFAULT_OPTIONS")) && *env) detected.options = env;
+        #endif
+
+        return detected;
+    }
+
+private:
+    int table[TABLE_SIZE];
+    XkbLayoutNames names;
+    bool built = false;
+
+    #ifdef __linux__
+    static std::string trim_value(const char *value) {
+        std::string out(value);
+        while (!out.empty() && (out.back() == '\n' || out.back() == '\r' || out.back() == ' ' || out.back() == '"'))
+            out.pop_back();
+        size_t start = 0;
+        while (start < out.size() && (out[start] == ' ' || out[start] == '"')) start++;
+        return out.substr(start);
+    }
+
+    // Debian style KEY="value" file.
+    static void read_keyboard_defaults(const char *path, XkbLayoutNames &out) {
+        FILE *file = fopen(path, "r");
+        if (!file) return;
+
+        char line[256];
+        while (fgets(line, sizeof(line), file)) {
+            if (strncmp(line, "XKBMODEL=", 9) == 0) out.model = trim_value(line + 9);
+            else if (strncmp(line, "XKBLAYOUT=", 10) == 0) out.layout = trim_value(line + 10);
+            else if (strncmp(line, "XKBVARIANT=", 11) == 0) out.variant = trim_value(line + 11);
+            else if (strncmp(line, "XKBOPTIONS=", 11) == 0) out.options = trim_value(line + 11);
+        }
+        fclose(file);
+    }
+
+    // Option "XkbLayout" "de" lines written by localectl.
+    static void read_xorg_keyboard_conf(const char *path, XkbLayoutNames &out) {
+        FILE *file = fopen(path, "r");
+        if (!file) return;
+
+        char line[256];
+        while (fgets(line, sizeof(line), file)) {
+            const char *key = strstr(line, "\"Xkb");
+            if (!key || !strstr(line, "Option")) continue;
+
+            std::string *field = nullptr;
+            if (strncmp(key, "\"XkbModel\"", 10) == 0) field = &out.model;
+            else if (strncmp(key, "\"XkbLayout\"", 11) == 0) field = &out.layout;
+            else if (strncmp(key, "\"XkbVariant\"", 12) == 0) field = &out.variant;
+            else if (strncmp(key, "\"XkbOptions\"", 12) == 0) field = &out.options;
+            if (!field) continue;
+
+            const char *name_end = strchr(key + 1, '"');
+            const char *value = name_end ? strchr(name_end + 1, '"') : nullptr;
+            if (value) *field = trim_value(value + 1);
+        }
+        fclose(file);
+    }
+    #endif
+
+    #if defined(__linux__) && defined(GI_USE_XKBCOMMON)
+    static const char *or_null(const std::string &value) {
+        return value.empty() ? nullptr : value.c_str();
+    }
+
+    bool compile_layout(const XkbLayoutNames &p_names, int *out) {
+        struct xkb_context *ctx = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+        if (!ctx) return false;
+
+        struct xkb_rule_names rmlvo = {
+            or_null(p_names.rules),
+            or_null(p_names.model),
+            or_null(p_names.layout),
+            or_null(p_names.variant),
+            or_null(p_names.options),
+        };
+
+        struct xkb_keymap *keymap = xkb_keymap_new_from_names(ctx, &rmlvo, XKB_KEYMAP_COMPILE_NO_FLAGS);
+        if (!keymap) {
+            xkb_context_unref(ctx);
+            return false;
+        }
+
+        for (int code = 0; code < TABLE_SIZE; code++) {
+            const xkb_keysym_t *syms = nullptr;
+            // xkb keycodes are evdev codes offset by 8.
+            int count = xkb_keymap_key_get_syms_by_level(keymap, code + 8, 0, 0, &syms);
+            if (count <= 0) continue;
+
+            int godot_key = keysym_to_godot_key(syms[0]);
+            if (godot_key != 0) out[code] = godot_key;
+        }
+
+        xkb_keymap_unref(keymap);
+        xkb_context_unref(ctx);
+        return true;
+    }
+
+    static int keysym_to_godot_key(xkb_keysym_t sym) {
+        if (sym >= XKB_KEY_F1 && sym <= XKB_KEY_F24) return KEY_F1 + (int)(sym - XKB_KEY_F1);
+        if (sym >= XKB_KEY_KP_0 && sym <= XKB_KEY_KP_9) return KEY_KP_0 + (int)(sym - XKB_KEY_KP_0);
+
+        switch (sym) {
+            case XKB_KEY_Escape: return KEY_ESCAPE;
+            case XKB_KEY_Tab: case XKB_KEY_ISO_Left_Tab: return KEY_TAB;
+            case XKB_KEY_BackSpace: return KEY_BACKSPACE;
+            case XKB_KEY_Return: return KEY_ENTER;
+            case XKB_KEY_KP_Enter: return KEY_KP_ENTER;
+            case XKB_KEY_Insert: return KEY_INSERT;
+            case XKB_KEY_Delete: return KEY_DELETE;
+            case XKB_KEY_Pause: return KEY_PAUSE;
+            case XKB_KEY_Print: return KEY_PRINT;
+            case XKB_KEY_Sys_Req: return KEY_SYSREQ;
+            case XKB_KEY_Home: return KEY_HOME;
+            case XKB_KEY_End: return KEY_END;
+            case XKB_KEY_Left: return KEY_LEFT;
+            case XKB_KEY_Up: return KEY_UP;
+            case XKB_KEY_Right: return KEY_RIGHT;
+            case XKB_KEY_Down: return KEY_DOWN;
+            case XKB_KEY_Prior: return KEY_PAGEUP;
+            case XKB_KEY_Next: return KEY_PAGEDOWN;
+            case XKB_KEY_Shift_L: case XKB_KEY_Shift_R: return KEY_SHIFT;
+            case XKB_KEY_Control_L: case XKB_KEY_Control_R: return KEY_CTRL;
+            case XKB_KEY_Alt_L: case XKB_KEY_Alt_R: case XKB_KEY_ISO_Level3_Shift: return KEY_ALT;
+            case XKB_KEY_Super_L: case XKB_KEY_Super_R: case XKB_KEY_Meta_L: case XKB_KEY_Meta_R: return KEY_META;
+            case XKB_KEY_Caps_Lock: return KEY_CAPSLOCK;
+            case XKB_KEY_Num_Lock: return KEY_NUMLOCK;
+            case XKB_KEY_Scroll_Lock: return KEY_SCROLLLOCK;
+            case XKB_KEY_Menu: return KEY_MENU;
+            case XKB_KEY_KP_Multiply: return KEY_KP_MULTIPLY;
+            case XKB_KEY_KP_Divide: return KEY_KP_DIVIDE;
+            case XKB_KEY_KP_Subtract: return KEY_KP_SUBTRACT;
+            case XKB_KEY_KP_Add: return KEY_KP_ADD;
+            case XKB_KEY_KP_Decimal: case XKB_KEY_KP_Separator: return KEY_KP_PERIOD;
+            // Dead keys report the character they would compose.
+            case XKB_KEY_dead_grave: return KEY_QUOTELEFT;
+            case XKB_KEY_dead_circumflex: return KEY_ASCIICIRCUM;
+            case XKB_KEY_dead_tilde: return KEY_ASCIITILDE;
+            case XKB_KEY_dead_acute: return 0xB4;
+            case XKB_KEY_dead_diaeresis: return 0xA8;
+            default: break;
+        }
+
+        uint32_t unicode = xkb_keysym_to_utf32(sym);
+        if (unicode < 0x20 || unicode > 0xFF || unicode == 0x7F) return 0;
+
+        // Godot reports letters by their upper case code point.
+        if (unicode >= 'a' && unicode <= 'z') return (int)(unicode - 0x20);
+        if (unicode >= 0xE0 && unicode <= 0xFE && unicode != 0xF7) return (int)(unicode - 0x20);
+        return (int)unicode;
+    }
+    #endif
+};
@@ -231,4 +231,14 @@ public:
         mouse_state[button] = now;
     }
 
+private:
+    bool running = false;
+
+    std::unordered_map<int, bool> key_state;
+    std::unordered_map<int, uint64_t> key_just_pressed_frame;
+    std::unordered_map<int, uint64_t> key_just_released_frame;
+
+    std::unordered_map<int, bool> mouse_state;
+    std::unordered_map<int, uint64_t> mouse_just_pressed_frame;
+    std::unordered_map<int, uint64_t> mouse_just_released_frame;
 };
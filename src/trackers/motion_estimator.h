@@ -0,0 +1,98 @@
+#pragma once
+
+#include <godot_cpp/variant/vector2.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <stdint.h>
+
+using namespace godot;
+
+// Pointer motion totals plus an exponentially smoothed velocity and acceleration.
+// Samples are timestamped by the source (kernel event time on Linux) on the
+// steady clock, so the estimate doesn't depend on how often anyone polls it.
+class MotionEstimator {
+public:
+    // Time constant of the smoothing, about how far back the estimate looks.
+    static constexpr double SMOOTHING_SECONDS = 0.05;
+    // Gaps longer than this start a new stroke from rest.
+    static constexpr double IDLE_SECONDS = 0.1;
+    // Caps the first sample of a stroke, whose interval includes the idle time.
+    static constexpr double MAX_SAMPLE_SECONDS = 0.02;
+
+    static uint64_t now_usec() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Raw motion, folded into the estimate on the next report().
+    void add(double dx, double dy) {
+        pending_x += dx;
+        pending_y += dy;
+        total_x += dx;
+        total_y += dy;
+    }
+
+    // One hardware report (SYN_REPORT on evdev) finished at `usec`.
+    void report(uint64_t usec) {
+        if (last_usec == 0 || usec <= last_usec) {
+            last_usec = usec;
+            pending_x = pending_y = 0.0;
+            return;
+        }
+
+        double dt = (double)(usec - last_usec) / 1000000.0;
+        last_usec = usec;
+
+        if (dt > IDLE_SECONDS) {
+            velocity_x = velocity_y = 0.0;
+            acceleration_x = acceleration_y = 0.0;
+        }
+        dt = std::fmin(dt, MAX_SAMPLE_SECONDS);
+
+        double alpha = 1.0 - std::exp(-dt / SMOOTHING_SECONDS);
+        double next_x = velocity_x + alpha * (pending_x / dt - velocity_x);
+        double next_y = velocity_y + alpha * (pending_y / dt - velocity_y);
+
+        acceleration_x += alpha * ((next_x - velocity_x) / dt - acceleration_x);
+        acceleration_y += alpha * ((next_y - velocity_y) / dt - acceleration_y);
+        velocity_x = next_x;
+        velocity_y = next_y;
+
+        pending_x = pending_y = 0.0;
+    }
+
+    // Unclamped motion since the estimator was created.
+    double get_total_x() const { return total_x; }
+    double get_total_y() const { return total_y; }
+
+    // Pixels per second, decayed for the time since the last report.
+    Vector2 get_velocity(uint64_t usec) const {
+        double decay = decay_at(usec);
+        return Vector2((float)(velocity_x * decay), (float)(velocity_y * decay));
+    }
+
+    // Pixels per second squared, decayed the same way.
+    Vector2 get_acceleration(uint64_t usec) const {
+        double decay = decay_at(usec);
+        return Vector2((float)(acceleration_x * decay), (float)(acceleration_y * decay));
+    }
+
+private:
+    double total_x = 0.0;
+    double total_y = 0.0;
+    double pending_x = 0.0;
+    double pending_y = 0.0;
+
+    double velocity_x = 0.0;
+    double velocity_y = 0.0;
+    double acceleration_x = 0.0;
+    double acceleration_y = 0.0;
+    uint64_t last_usec = 0;
+
+    double decay_at(uint64_t usec) const {
+        if (last_usec == 0 || usec <= last_usec) return 1.0;
+        double idle = (double)(usec - last_usec) / 1000000.0;
+        return std::exp(-idle / SMOOTHING_SECONDS);
+    }
+};
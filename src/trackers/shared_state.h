@@ -0,0 +1,191 @@
+#pragma once
+
+#include "keymaps.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+using namespace godot;
+
+// Layout of the shared memory region published for companion processes.
+// Readers map it read-only and copy what they need between two reads of
+// `sequence`, retrying while it is odd or changed (a seqlock). Bump
+// SHARED_STATE_VERSION whenever this layout changes.
+static constexpr uint32_t SHARED_STATE_MAGIC = 0x504E4947; // "GINP"
+static constexpr uint32_t SHARED_STATE_VERSION = 1;
+static constexpr uint32_t SHARED_STATE_KEY_BITS = 512;
+static constexpr uint32_t SHARED_STATE_EVENT_CAPACITY = 256;
+
+enum SharedInputEventType : uint32_t {
+    SHARED_EVENT_KEY = 1,
+    SHARED_EVENT_MOUSE_BUTTON = 2,
+    SHARED_EVENT_JOY_BUTTON = 3,
+};
+
+struct SharedInputEvent {
+    uint64_t time_usec;   // steady clock
+    uint32_t type;        // SharedInputEventType
+    int32_t code;         // Godot Key, MouseButton, or pad * 256 + JoyButton
+    int32_t pressed;
+    uint32_t reserved;
+};
+
+struct SharedInputState {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t event_capacity;
+    std::atomic<uint32_t> sequence;
+    uint32_t reserved;
+
+    // Bit n is the Godot key n for n < 256, and KEY_SPECIAL + (n - 256) above.
+    uint64_t key_bits[SHARED_STATE_KEY_BITS / 64];
+
+    float mouse_x;
+    float mouse_y;
+    uint32_t mouse_buttons; // bit (MouseButton - 1)
+    int32_t wheel;
+
+    // Total events ever written; event n lives at events[n % event_capacity].
+    uint64_t event_count;
+    SharedInputEvent events[SHARED_STATE_EVENT_CAPACITY];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "the seqlock must be lock free to live in shared memory");
+
+// Writer side, owned by the hub and only touched under its state_mutex.
+class SharedStatePublisher {
+public:
+    ~SharedStatePublisher() { close(); }
+
+    // Creates (or takes over) the named region, "/name" on POSIX and "Local\name" on Windows.
+    bool open(const std::string &p_name) {
+        close();
+
+        #if defined(__linux__)
+        std::string path = p_name[0] == '/' ? p_name : "/" + p_name;
+        int fd = shm_open(path.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0600);
+        if (fd < 0) return false;
+
+        if (ftruncate(fd, sizeof(SharedInputState)) < 0) {
+            ::close(fd);
+            shm_unlink(path.c_str());
+            return false;
+        }
+
+        void *memory = mmap(nullptr, sizeof(SharedInputState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (memory == MAP_FAILED) {
+            shm_unlink(path.c_str());
+            return false;
+        }
+        name = path;
+
+        #elif defined(_WIN32)
+        std::string path = "Local\\" + p_name;
+        mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(SharedInputState), path.c_str());
+        if (!mapping) return false;
+
+        void *memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedInputState));
+        if (!memory) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+            return false;
+        }
+        name = path;
+
+        #else
+        return false;
+        #endif
+
+        state = (SharedInputState *)memory;
+        memset((void *)state, 0, sizeof(SharedInputState));
+        state->size = sizeof(SharedInputState);
+        state->event_capacity = SHARED_STATE_EVENT_CAPACITY;
+        state->version = SHARED_STATE_VERSION;
+        // Magic goes last so readers never accept a half initialized region.
+        std::atomic_thread_fence(std::memory_order_release);
+        state->magic = SHARED_STATE_MAGIC;
+        return true;
+    }
+
+    void close() {
+        if (!state) return;
+
+        #if defined(__linux__)
+        munmap((void *)state, sizeof(SharedInputState));
+        shm_unlink(name.c_str());
+        #elif defined(_WIN32)
+        UnmapViewOfFile(state);
+        CloseHandle(mapping);
+        mapping = nullptr;
+        #endif
+
+        state = nullptr;
+        name.clear();
+    }
+
+    bool is_open() const { return state != nullptr; }
+    const std::string &get_name() const { return name; }
+
+    // Updates the key/button bitmaps and appends the edge to the event ring.
+    void push_edge(const SharedInputEvent &event) {
+        begin_write();
+        if (event.type == SHARED_EVENT_KEY) {
+            int bit = key_bit(event.code);
+            if (bit >= 0) set_bit(state->key_bits[bit / 64], (uint64_t)1 << (bit % 64), event.pressed);
+        } else if (event.type == SHARED_EVENT_MOUSE_BUTTON && event.code >= 1 && event.code <= 32) {
+            set_bit(state->mouse_buttons, (uint32_t)1 << (event.code - 1), event.pressed);
+        }
+
+        state->events[state->event_count % SHARED_STATE_EVENT_CAPACITY] = event;
+        state->event_count++;
+        end_write();
+    }
+
+    // Pointer state is published once per processed batch rather than per event.
+    void set_pointer(float x, float y, int wheel) {
+        if (state->mouse_x == x && state->mouse_y == y && state->wheel == wheel) return;
+        begin_write();
+        state->mouse_x = x;
+        state->mouse_y = y;
+        state->wheel = wheel;
+        end_write();
+    }
+
+    static int key_bit(int key) {
+        if (key >= 0 && key < 256) return key;
+        if (key >= KEY_SPECIAL && key < KEY_SPECIAL + (int)SHARED_STATE_KEY_BITS - 256) return 256 + (key - KEY_SPECIAL);
+        return -1;
+    }
+
+private:
+    SharedInputState *state = nullptr;
+    std::string name;
+    #ifdef _WIN32
+    HANDLE mapping = nullptr;
+    #endif
+
+    void begin_write() {
+        state->sequence.store(state->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void end_write() {
+        state->sequence.store(state->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    template <typename T>
+    static void set_bit(T &bits, T mask, bool on) {
+        if (on) bits |= mask;
+        else bits &= ~mask;
+    }
+};
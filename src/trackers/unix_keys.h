@@ -782,7 +782,7 @@
 /* We avoid low common keys in module aliases so they don't get huge. */
 #define PH_KEY_MIN_INTERESTING	KEY_MUTE
 #define PH_KEY_MAX			0x2ff
-#define PH_KEY_CNT			(KEY_MAX+1)
+#define PH_KEY_CNT			(PH_KEY_MAX+1)
 
 /*
  * Relative axes
@@ -1,344 +1,212 @@
 #pragma once
-#include "../common.h"
+#include "../input_hub.h"
 
 using namespace godot;
 
-class WindowsGlobalInput : public GlobalInputCommon {
-public:
-    WindowsGlobalInput(){}
-    ~WindowsGlobalInput(){ stop();}
-
-    // Start/ Stop Hook
-
-    void start() {
-        if (running) return;
-
-        if (!OS::get_singleton()) {
-            running = false;
-            return;
-        }
-        if (OS::get_singleton()->has_feature("editor_hint")){
-            running = false;
-            return;
-        }
-
-        key_state.clear();
-        key_just_pressed_frame.clear();
-        key_just_released_frame.clear();
-
-        mouse_state.clear();
-        mouse_just_pressed_frame.clear();
-        mouse_just_released_frame.clear();
-
-        running = true;
-        key_maps->get_platform_key_mapping(key_map);
-        hook_thread = std::thread(&poll_input, this);
-    }
-
-    void stop(){
-        if (running){
-            std::lock_guard<std::recursive_mutex> lock(state_mutex);
-            running = false;
-            if (hook_thread.joinable())
-                hook_thread.join();  
-        }
+class WindowsInputHub : public InputHub {
+protected:
+    bool open() override {
+        std::lock_guard<std::recursive_mutex> lock(state_mutex);
+        apply_tracked_keys();
+        return true;
     }
 
-    // Polling Data
+    void close() override {}
 
-    void poll_data() override {
-        std::lock_guard<std::recursive_mutex> lock(state_mutex);
-
-        for (auto &it : key_just_pressed_frame) {
-            if (it.second == 0) {
-                it.second = current_frame;
-            }
+    // The polling loop only asks for the keys someone tracks.
+    void apply_tracked_keys() override {
+        #ifdef _WIN32
+        polled_keys.clear();
+        for (const auto &[vk, godot_key] : key_map) {
+            if (is_key_tracked(godot_key)) polled_keys.emplace_back(vk, godot_key);
         }
+        #endif
+    }
 
-        for (auto &it : key_just_released_frame) {
-            if (it.second == 0) {
-                it.second = current_frame;
-            }
-        }
+    void run() override {
+        #ifdef _WIN32
+            while (running) {
+                if (!OS::get_singleton()) {
+                    running = false;
+                    return;
+                }
 
-        for (auto &it : mouse_just_pressed_frame) {
-            if (it.second == 0) {
-                it.second = current_frame;
-            }
-        }
+                // Low level hooks park the thread in GetMessage until something happens.
+                if (power_saving) {
+                    run_hooks();
+                    continue;
+                }
 
-        for (auto &it : mouse_just_released_frame) {
-            if (it.second == 0) {
-                it.second = current_frame;
+                poll_state();
+                wakeups++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
             }
-        }
+        #endif
     }
 
-    void increment_frame() override{
-        std::lock_guard<std::recursive_mutex> lock(state_mutex);
-        current_frame++;    
+    void wake() override {
+        #ifdef _WIN32
+        DWORD thread_id = hook_thread_id.load();
+        if (thread_id != 0) PostThreadMessage(thread_id, WM_APP, 0, 0);
+        #endif
     }
 
-    // Basic Key Input
+private:
+    #ifdef _WIN32
+    static inline WindowsInputHub *hook_owner = nullptr;
+    std::atomic<DWORD> hook_thread_id{0};
+    std::vector<std::pair<int, int>> polled_keys; // VK -> Godot key
 
-    bool is_key_pressed(int key) override{
+    void poll_state() {
         std::lock_guard<std::recursive_mutex> lock(state_mutex);
-        auto it = key_state.find(key);
-        return it != key_state.end() && it->second;
-    }
 
-    bool is_key_just_pressed(int key) override{
-        std::lock_guard<std::recursive_mutex> lock(state_mutex);
-        auto it = key_just_pressed_frame.find(key);
-        return it != key_just_pressed_frame.end() &&
-            it->second != 0 &&
-            (current_frame - it->second) <= JUST_BUFFER_FRAMES;
-    }
+        for (const auto &[vk, godot_key] : polled_keys) {
+            SHORT state = GetAsyncKeyState(vk);
+            set_key(godot_key, (state & 0x8000) != 0);
+        }
 
-    bool is_key_just_released(int key) override{
-        std::lock_guard<std::recursive_mutex> lock(state_mutex);
-        auto it = key_just_released_frame.find(key);
-        return it != key_just_released_frame.end() &&
-            it->second != 0 &&
-            (current_frame - it->second) <= JUST_BUFFER_FRAMES;
-    }
+        for (int vk : { VK_LSHIFT, VK_RSHIFT, VK_LCONTROL, VK_RCONTROL, VK_LMENU, VK_RMENU, VK_LWIN, VK_RWIN }) {
+            set_modifier(modifier_bit(vk), (GetAsyncKeyState(vk) & 0x8000) != 0);
+        }
 
-    // Mouse Input
+        POINT p;
+        if (GetCursorPos(&p)) move_cursor(p);
 
-    bool is_mouse_pressed(int button) override{
-        std::lock_guard<std::recursive_mutex> lock(state_mutex);
-        auto it = mouse_state.find(button);
-        return it != mouse_state.end() && it->second;
-    }
+        int buttons[] = { VK_LBUTTON, VK_RBUTTON, VK_MBUTTON };
+        int godot_buttons[] = {
+            MOUSE_BUTTON_LEFT,
+            MOUSE_BUTTON_RIGHT,
+            MOUSE_BUTTON_MIDDLE
+        };
 
-    bool is_mouse_just_pressed(int button) override{
-        std::lock_guard<std::recursive_mutex> lock(state_mutex);
-        auto it = mouse_just_pressed_frame.find(button);
-        return it != mouse_just_pressed_frame.end() &&
-            it->second != 0 &&
-            (current_frame - it->second) <= JUST_BUFFER_FRAMES;
+        for (int i = 0; i < 3; i++) {
+            SHORT state = GetAsyncKeyState(buttons[i]);
+            set_mouse_button(godot_buttons[i], (state & 0x8000) != 0);
+        }
+        publish_pointer();
     }
 
-    bool is_mouse_just_released(int button) override{
-        std::lock_guard<std::recursive_mutex> lock(state_mutex);
-        auto it = mouse_just_released_frame.find(button);
-        return it != mouse_just_released_frame.end() &&
-            it->second != 0 &&
-            (current_frame - it->second) <= JUST_BUFFER_FRAMES;
-    }
+    void move_cursor(const POINT &p) {
+        Vector2 position(p.x, p.y);
+        if (position == mouse_position) return;
 
-    Vector2 get_mouse_position() override{
-        std::lock_guard<std::recursive_mutex> lock(state_mutex);
-        return mouse_position;
+        Vector2 delta = position - mouse_position;
+        motion.add(delta.x, delta.y);
+        motion.report(MotionEstimator::now_usec());
+        mouse_position = position;
+        record_path_sample();
     }
 
-    // Godot InputMap Action Detection
+    // Returns when woken by wake(), either to stop or to leave power saving.
+    void run_hooks() {
+        MSG msg;
+        // Creates the message queue before wake() may post to it.
+        PeekMessage(&msg, nullptr, 0, 0, PM_NOREMOVE);
+        hook_thread_id.store(GetCurrentThreadId());
 
-    bool is_action_pressed(const String &action) override{
-        if (!InputMap::get_singleton()) return false;
-        const Array events = InputMap::get_singleton()->action_get_events(action);
-        std::lock_guard<std::recursive_mutex> lock(state_mutex);
-
-        for (int i = 0; i < events.size(); i++) {
-            Ref<InputEvent> ev = events[i];
-            if (!ev.is_valid()) continue;
+        hook_owner = this;
+        HHOOK keyboard_hook = SetWindowsHookEx(WH_KEYBOARD_LL, keyboard_proc, GetModuleHandle(nullptr), 0);
+        HHOOK mouse_hook = SetWindowsHookEx(WH_MOUSE_LL, mouse_proc, GetModuleHandle(nullptr), 0);
 
-            if (auto *key_ev = Object::cast_to<InputEventKey>(ev.ptr())) {
-                if (!modifiers_match(key_ev)) continue; 
-                if (key_state[key_ev->get_keycode()]) return true;
-            } else if (auto *mouse_ev = Object::cast_to<InputEventMouseButton>(ev.ptr())) {
-                if (!modifiers_match(key_ev)) continue; 
-                if (mouse_state[mouse_ev->get_button_index()]) return true;
-            }
+        if (!keyboard_hook || !mouse_hook) {
+            godot::print_line("Global Input: Failed to install low level hooks, polling instead.");
+            power_saving = false;
         }
-        return false;
-    }
-
-    bool is_action_just_pressed(const String &action) override{
-        if (!InputMap::get_singleton()) return false;
-        const Array events = InputMap::get_singleton()->action_get_events(action);
-        std::lock_guard<std::recursive_mutex> lock(state_mutex);
 
-        for (int i = 0; i < events.size(); i++) {
-            Ref<InputEvent> ev = events[i];
-            if (!ev.is_valid()) continue;
-
-            if (auto *key_ev = Object::cast_to<InputEventKey>(ev.ptr())) {
-                auto it = key_just_pressed_frame.find(key_ev->get_keycode());
-                if (!modifiers_match(key_ev)) continue; 
-                if (it != key_just_pressed_frame.end() &&
-                    it->second != 0 &&
-                    (current_frame - it->second) <= JUST_BUFFER_FRAMES)
-                    return true;
-            } else if (auto *mouse_ev = Object::cast_to<InputEventMouseButton>(ev.ptr())) {
-                auto it = mouse_just_pressed_frame.find(mouse_ev->get_button_index());
-                if (!modifiers_match(key_ev)) continue; 
-                if (it != mouse_just_pressed_frame.end() &&
-                    it->second != 0 &&
-                    (current_frame - it->second) <= JUST_BUFFER_FRAMES)
-                    return true;
-            }
+        while (running && power_saving && GetMessage(&msg, nullptr, 0, 0) > 0) {
+            wakeups++;
         }
-        return false;
-    }
 
-    bool is_action_just_released(const String &action) override{
-        if (!InputMap::get_singleton()) return false;
-        const Array events = InputMap::get_singleton()->action_get_events(action);
-        std::lock_guard<std::recursive_mutex> lock(state_mutex);
-
-        for (int i = 0; i < events.size(); i++) {
-            Ref<InputEvent> ev = events[i];
-            if (!ev.is_valid()) continue;
-
-            if (auto *key_ev = Object::cast_to<InputEventKey>(ev.ptr())) {
-                auto it = key_just_released_frame.find(key_ev->get_keycode());
-                if (!modifiers_match(key_ev)) continue; 
-                if (it != key_just_released_frame.end() && (current_frame - it->second) <= 1) return true;
-            } else if (auto *mouse_ev = Object::cast_to<InputEventMouseButton>(ev.ptr())) {
-                auto it = mouse_just_released_frame.find(mouse_ev->get_button_index());
-                if (!modifiers_match(key_ev)) continue; 
-                if (it != mouse_just_released_frame.end() && (current_frame - it->second) <= 1) return true;
-            }
-        }
-        return false;
+        if (keyboard_hook) UnhookWindowsHookEx(keyboard_hook);
+        if (mouse_hook) UnhookWindowsHookEx(mouse_hook);
+        hook_owner = nullptr;
+        hook_thread_id.store(0);
     }
-    
-    // Debug Returns
 
-    Dictionary get_keys_pressed_detailed() override{
-        Dictionary dict;
-        std::lock_guard<std::recursive_mutex> lock(state_mutex);
-        for (const auto &[key, down] : key_state) {
-            if (!down) continue;
-            String name = "Unknown";
-            if (OS::get_singleton() && key >= 0 && key <= KEY_MENU)
-                name = OS::get_singleton()->get_keycode_string((Key)key);
-            dict[name] = true;
-            dict["os"] = "Windows";
+    // The low level hooks report sided modifiers, key_map uses the generic ones.
+    static int generic_vk(DWORD vk) {
+        switch (vk) {
+            case VK_LSHIFT: case VK_RSHIFT: return VK_SHIFT;
+            case VK_LCONTROL: case VK_RCONTROL: return VK_CONTROL;
+            case VK_LMENU: case VK_RMENU: return VK_MENU;
+            default: return (int)vk;
         }
-        return dict;
     }
 
-    Dictionary get_keys_just_pressed_detailed() override{
-        Dictionary dict;
-        std::lock_guard<std::recursive_mutex> lock(state_mutex);
-        for (const auto &[key, frame] : key_just_pressed_frame) {
-            if ((current_frame - frame) > 1) continue;
-            String name = "Unknown";
-            if (OS::get_singleton() && key >= 0 && key <= KEY_MENU)
-                name = OS::get_singleton()->get_keycode_string((Key)key);
-            dict[name] = true;
-            dict["os"] = "Windows";
+    static uint32_t modifier_bit(DWORD vk) {
+        switch (vk) {
+            case VK_LSHIFT: return GlobalInputCommon::MODIFIER_LEFT_SHIFT;
+            case VK_RSHIFT: return GlobalInputCommon::MODIFIER_RIGHT_SHIFT;
+            case VK_LCONTROL: return GlobalInputCommon::MODIFIER_LEFT_CTRL;
+            case VK_RCONTROL: return GlobalInputCommon::MODIFIER_RIGHT_CTRL;
+            case VK_LMENU: return GlobalInputCommon::MODIFIER_LEFT_ALT;
+            case VK_RMENU: return GlobalInputCommon::MODIFIER_RIGHT_ALT;
+            case VK_LWIN: return GlobalInputCommon::MODIFIER_LEFT_META;
+            case VK_RWIN: return GlobalInputCommon::MODIFIER_RIGHT_META;
+            default: return 0;
         }
-        return dict;
     }
 
-    Dictionary get_keys_just_released_detailed() override{
-        Dictionary dict;
-        std::lock_guard<std::recursive_mutex> lock(state_mutex);
-        for (const auto &[key, frame] : key_just_released_frame) {
-            if ((current_frame - frame) > 1) continue;
-            String name = "Unknown";
-            if (OS::get_singleton() && key >= 0 && key <= KEY_MENU)
-                name = OS::get_singleton()->get_keycode_string((Key)key);
-            dict[name] = true;
-            dict["os"] = "Windows";
+    static LRESULT CALLBACK keyboard_proc(int code, WPARAM wparam, LPARAM lparam) {
+        WindowsInputHub *hub = hook_owner;
+        if (code == HC_ACTION && hub) {
+            const KBDLLHOOKSTRUCT *info = (const KBDLLHOOKSTRUCT *)lparam;
+            bool pressed = wparam == WM_KEYDOWN || wparam == WM_SYSKEYDOWN;
+
+            hub->wakeups++;
+            std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+            uint32_t modifier = modifier_bit(info->vkCode);
+            auto it = hub->key_map.find(generic_vk(info->vkCode));
+            if (modifier != 0) {
+                if (pressed && (hub->modifier_mask.load() & modifier)) hub->repeat_key(GlobalInputCommon::modifier_key(modifier));
+                else hub->set_modifier(modifier, pressed);
+            } else if (it != hub->key_map.end() && hub->is_key_tracked(it->second)) {
+                // Windows repeats WM_KEYDOWN while a key is held.
+                if (pressed && hub->key_state[it->second]) hub->repeat_key(it->second);
+                else hub->set_key(it->second, pressed);
+            }
         }
-        return dict;
-    }
-
-    // Modifiers
-
-    bool is_alt_pressed() override{
-        #ifdef _WIN32
-        return is_key_pressed(VK_MENU) || is_key_pressed(VK_LMENU) || is_key_pressed(VK_RMENU) || is_key_pressed(KEY_ALT);
-        #endif
-        return false;
-    }
-
-    bool is_ctrl_pressed() override{
-        #ifdef _WIN32
-        return is_key_pressed(VK_CONTROL) || is_key_pressed(VK_LCONTROL) || is_key_pressed(VK_RCONTROL) || is_key_pressed(KEY_CTRL);
-        #endif
-        return false;
-
-    }
-
-    bool is_shift_pressed() override{
-        #ifdef _WIN32
-        return is_key_pressed(VK_SHIFT) || is_key_pressed(VK_LSHIFT) || is_key_pressed(VK_RSHIFT) ||  is_key_pressed(KEY_SHIFT);
-        #endif
-        return false;
-    }
-
-    bool is_meta_pressed() override{
-        #ifdef _WIN32
-        return is_key_pressed(VK_LWIN) || is_key_pressed(VK_RWIN) || is_key_pressed(KEY_META);
-        #endif
-        return false;
-    }
-
-    // Misc
-
-    void handle_input(const Ref<InputEvent> &event) override {};
-
-    void poll_input() {
-        #ifdef _WIN32
-            while (running) {
-                {
-                    if (!OS::get_singleton()) {
-                        running = false;
-                        return;
-                    }
-                    
-                    std::lock_guard<std::recursive_mutex> lock(state_mutex);
-
-                    for (const auto &[vk, godot_key] : key_map) {
-                        SHORT state = GetAsyncKeyState(vk);
-                        bool pressed = (state & 0x8000) != 0;
-                        bool was_pressed = key_state[godot_key];
-
-                        key_state[godot_key] = pressed;
-
-                        if (pressed && !was_pressed)
-                            key_just_pressed_frame[godot_key] = 0;
-
-                        if (!pressed && was_pressed)
-                            key_just_released_frame[godot_key] = 0;
-                    }
-
-                    POINT p;
-                    if (GetCursorPos(&p)) {
-                        mouse_position = Vector2(p.x, p.y);
-                    }
-
-                    int buttons[] = { VK_LBUTTON, VK_RBUTTON, VK_MBUTTON };
-                    int godot_buttons[] = {
-                        MOUSE_BUTTON_LEFT,
-                        MOUSE_BUTTON_RIGHT,
-                        MOUSE_BUTTON_MIDDLE
-                    };
-
-                    for (int i = 0; i < 3; i++) {
-                        SHORT state = GetAsyncKeyState(buttons[i]);
-                        bool pressed = (state & 0x8000) != 0;
-                        bool was_pressed = mouse_state[godot_buttons[i]];
-
-                        mouse_state[godot_buttons[i]] = pressed;
-
-                        if (pressed && !was_pressed)
-                            mouse_just_pressed_frame[godot_buttons[i]] = 0;
-
-                        if (!pressed && was_pressed)
-                            mouse_just_released_frame[godot_buttons[i]] = 0;
-                    }
+        return CallNextHookEx(nullptr, code, wparam, lparam);
+    }
+
+    static LRESULT CALLBACK mouse_proc(int code, WPARAM wparam, LPARAM lparam) {
+        WindowsInputHub *hub = hook_owner;
+        if (code == HC_ACTION && hub) {
+            const MSLLHOOKSTRUCT *info = (const MSLLHOOKSTRUCT *)lparam;
+
+            hub->wakeups++;
+            std::lock_guard<std::recursive_mutex> lock(hub->state_mutex);
+            switch (wparam) {
+                case WM_MOUSEMOVE: hub->move_cursor(info->pt); break;
+                case WM_LBUTTONDOWN: hub->set_mouse_button(MOUSE_BUTTON_LEFT, true); break;
+                case WM_LBUTTONUP: hub->set_mouse_button(MOUSE_BUTTON_LEFT, false); break;
+                case WM_RBUTTONDOWN: hub->set_mouse_button(MOUSE_BUTTON_RIGHT, true); break;
+                case WM_RBUTTONUP: hub->set_mouse_button(MOUSE_BUTTON_RIGHT, false); break;
+                case WM_MBUTTONDOWN: hub->set_mouse_button(MOUSE_BUTTON_MIDDLE, true); break;
+                case WM_MBUTTONUP: hub->set_mouse_button(MOUSE_BUTTON_MIDDLE, false); break;
+                case WM_XBUTTONDOWN: case WM_XBUTTONUP: {
+                    int button = HIWORD(info->mouseData) == XBUTTON1 ? MOUSE_BUTTON_XBUTTON1 : MOUSE_BUTTON_XBUTTON2;
+                    hub->set_mouse_button(button, wparam == WM_XBUTTONDOWN);
+                    break;
                 }
-
-                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                case WM_MOUSEWHEEL:
+                    hub->wheel_delta += (short)HIWORD(info->mouseData) / WHEEL_DELTA;
+                    break;
+                default:
+                    break;
             }
-        #endif
+            hub->publish_pointer();
+        }
+        return CallNextHookEx(nullptr, code, wparam, lparam);
     }
+    #endif
+};
 
+class WindowsGlobalInput : public HubInputView {
+public:
+    WindowsGlobalInput(){}
 
+protected:
+    InputHub *acquire_hub(bool async) override { return InputHub::acquire<WindowsInputHub>(async); }
+    const char *os_name() const override { return "Windows"; }
 };
@@ -0,0 +1,74 @@
+extends SceneTree
+
+# Hook thread benchmarks on virtual devices. Each line reports how long the
+# injection took, the CPU time the hook thread used meanwhile and its wakeup
+# rate. FIFOs can't take kernel event masks, so the tracked keys numbers only
+# show the filtering done on the hook thread. Run the many devices case
+# against a `use_io_uring=yes` build and a default one to compare the readers.
+
+const Harness = preload("res://harness.gd")
+
+const EV_KEY_Q := 16
+const EV_KEY_E := 18
+const EV_KEY_R := 19
+const SECONDS := 2
+const DEVICE_COUNT := 16
+
+var h: Harness
+var input: GlobalInput
+var path_points := 0
+
+
+func _initialize() -> void:
+	h = Harness.new(self)
+	run.call_deferred()
+
+
+func run() -> void:
+	var pointer := h.make_fifo("pointer.fifo")
+	var keyboard := h.make_fifo("keyboard.fifo")
+	var pointers: Array[String] = []
+	for i in DEVICE_COUNT:
+		pointers.append(h.make_fifo("pointer%d.fifo" % i))
+
+	var devices := {pointer: "pointer", keyboard: "keyboard"}
+	for path in pointers:
+		devices[path] = "pointer"
+	input = await h.start_evdev(devices)
+	if not input:
+		return
+
+	var motion := "motion:8000:%d" % (SECONDS * 1000)
+	var taps := "taps:20000:%d,%d,%d" % [EV_KEY_Q, EV_KEY_E, EV_KEY_R]
+
+	input.mouse_motion_mode = 0  # coalesced
+	await bench("8 kHz mouse, coalesced", [pointer], [motion])
+
+	input.mouse_motion_mode = 1  # path
+	process_frame.connect(count_path_points)
+	await bench("8 kHz mouse, path", [pointer], [motion])
+	process_frame.disconnect(count_path_points)
+	print("    path points delivered: %d" % path_points)
+	input.mouse_motion_mode = 0  # coalesced
+
+	await bench("40000 untracked key edges, all keys tracked", [keyboard], [taps])
+	input.set_tracked_keys([KEY_W, KEY_A, KEY_S, KEY_D])
+	await bench("40000 untracked key edges, WASD tracked", [keyboard], [taps])
+	input.clear_tracked_keys()
+
+	await bench("8 kHz mouse over %d devices" % DEVICE_COUNT, pointers, [motion])
+
+	input.stop_hook()
+	h.finish()
+
+
+func bench(name: String, paths: Array, steps: Array) -> void:
+	var result := await h.inject(paths, steps, ["--watch", str(OS.get_process_id())])
+	if result.is_empty():
+		return
+	print("%s: %d reports in %d ms, hook thread %d ms CPU, %.0f wakeups/s" % [
+		name, result["reports"], result["elapsed_ms"], result["hook_cpu_ms"], input.get_hook_wakeups_per_second()])
+
+
+func count_path_points() -> void:
+	path_points += input.get_mouse_path().size()
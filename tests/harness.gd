@@ -0,0 +1,118 @@
+extends RefCounted
+
+# Shared helpers for the headless tests and benchmarks. Every script runs as
+# the main loop (godot --headless -s), so `tree` is the script itself.
+
+const SKIP := 77
+
+var tree: SceneTree
+var failures := 0
+var holders: Array[int] = []
+var temp_files: Array[String] = []
+
+
+func _init(p_tree: SceneTree) -> void:
+	tree = p_tree
+
+
+func tool_path(name: String) -> String:
+	return ProjectSettings.globalize_path("res://bin/tools/" + name)
+
+
+func temp_path(name: String) -> String:
+	var path := "/tmp/gi_test_%d_%s" % [OS.get_process_id(), name]
+	temp_files.append(path)
+	return path
+
+
+func make_fifo(name: String) -> String:
+	var path := temp_path(name)
+	OS.execute("mkfifo", [path])
+	return path
+
+
+# Keeps a FIFO's write end open, since a virtual device closes once its last
+# writer leaves. Returns when the writer is in place.
+func hold_fifo(path: String) -> void:
+	var marker := path + ".held"
+	temp_files.append(marker)
+	holders.append(OS.create_process("sh", ["-c", 'exec 3>"$0" && : >"$0.held" && exec sleep 600', path]))
+	while not FileAccess.file_exists(marker):
+		await tree.process_frame
+
+
+# Starts a GlobalInput on the evdev backend with a US layout, reading only the
+# virtual devices in `devices` (FIFO path -> role). `settings` are properties
+# set before the hook starts. Holds every FIFO open and returns the node, or
+# finishes with SKIP and returns null where the evdev backend doesn't exist.
+func start_evdev(devices: Dictionary, settings: Dictionary = {}) -> GlobalInput:
+	var input := GlobalInput.new()
+	tree.root.add_child(input)
+	input.set_keyboard_layout("us")
+	for path in devices:
+		input.add_virtual_device(path, devices[path])
+	for property in settings:
+		input.set(property, settings[property])
+	input.backend = "evdev"
+	input.start_hook()
+
+	if input.get_active_backend() != "evdev":
+		print("evdev backend unavailable on this platform")
+		finish(SKIP)
+		return null
+
+	for path in devices:
+		await hold_fifo(path)
+	return input
+
+
+# Runs gi_inject on `paths` while frames keep going, and returns its summary
+# line as a Dictionary, empty if it failed.
+func inject(paths: Array, steps: Array, options: Array = []) -> Dictionary:
+	var args := options.duplicate()
+	args.append(",".join(paths))
+	args.append_array(steps)
+	return await run_tool("gi_inject", args)
+
+
+# Runs one of the helpers in tools/ while frames keep going. Returns the
+# key=value pairs of its last output line, empty if it failed.
+func run_tool(name: String, args: Array) -> Dictionary:
+	var out := temp_path("%s_%d.txt" % [name, Time.get_ticks_usec()])
+	var shell_args := ["-c", 'out=$1; shift; exec "$@" >"$out"', "sh", out, tool_path(name)]
+	shell_args.append_array(args)
+
+	var pid := OS.create_process("sh", shell_args)
+	while OS.is_process_running(pid):
+		await tree.process_frame
+
+	var summary := {}
+	var lines := FileAccess.get_file_as_string(out).strip_edges().split("\n")
+	for field in lines[lines.size() - 1].split(" ", false):
+		var pair: PackedStringArray = field.split("=")
+		if pair.size() == 2:
+			summary[pair[0]] = int(pair[1])
+	if summary.is_empty():
+		check(false, name + " " + " ".join(args))
+	return summary
+
+
+func frames(count: int) -> void:
+	for i in count:
+		await tree.process_frame
+
+
+func check(condition: bool, what: String) -> void:
+	if condition:
+		print("  ok   ", what)
+	else:
+		print("  FAIL ", what)
+		failures += 1
+
+
+func finish(status := -1) -> void:
+	for pid in holders:
+		OS.kill(pid)
+	for path in temp_files:
+		DirAccess.remove_absolute(path)
+	tree.quit(status if status >= 0 else (1 if failures > 0 else 0))
@@ -0,0 +1,59 @@
+#!/bin/sh
+# Runs the headless tests, or the benchmarks with `./run.sh bench`, against the
+# Linux build in src/bin/linux. Build it with `scons tests=yes` in src/ first,
+# which also builds the helpers in tools/. Needs Godot 4.2 or later as $GODOT.
+# No access to /dev/input is needed, input comes from virtual devices.
+
+cd "$(dirname "$0")" || exit 1
+GODOT=${GODOT:-godot}
+
+if ! command -v "$GODOT" >/dev/null 2>&1; then
+    echo "Godot not found, set GODOT to its binary"
+    exit 1
+fi
+if [ ! -x ../src/bin/linux/tools/gi_inject ]; then
+    echo "Helpers missing, run 'scons tests=yes' in src/"
+    exit 1
+fi
+
+# The extension list is what the editor would write on import.
+ln -sfn ../src/bin/linux bin
+mkdir -p .godot
+echo "res://global_input.gdextension" > .godot/extension_list.cfg
+
+failed=0
+run() {
+    echo "== $1"
+    "$GODOT" --headless --path . -s "$1"
+    case $? in
+        0) echo "PASS $1" ;;
+        77) echo "SKIP $1" ;;
+        *) echo "FAIL $1"; failed=1 ;;
+    esac
+}
+
+if [ "${1:-}" = bench ]; then
+    run bench_input.gd
+else
+    run test_virtual_devices.gd
+    run test_event_stream.gd
+
+    # The XInput2 test gets an X server of its own, and skips without Xvfb.
+    if command -v Xvfb >/dev/null 2>&1; then
+        : > .godot/xvfb_display
+        Xvfb -displayfd 3 -screen 0 1280x720x24 -nolisten tcp 3>.godot/xvfb_display >/dev/null 2>&1 &
+        xvfb=$!
+        while [ ! -s .godot/xvfb_display ] && kill -0 $xvfb 2>/dev/null; do sleep 0.1; done
+        if [ -s .godot/xvfb_display ]; then
+            DISPLAY=:$(cat .godot/xvfb_display)
+            export DISPLAY
+            run test_xinput2.gd
+            kill $xvfb
+        else
+            echo "SKIP test_xinput2.gd (Xvfb failed to start)"
+        fi
+    else
+        echo "SKIP test_xinput2.gd (Xvfb not found)"
+    fi
+fi
+exit $failed
@@ -0,0 +1,49 @@
+extends SceneTree
+
+# Event stream end to end: gi_stream_client subscribes to key events, writes
+# taps and clicks into a combo virtual device and checks order, filtering and
+# throughput of what the hook streams back. A second run stalls the client to
+# check that the hook drops and counts events instead of waiting for it.
+
+const Harness = preload("res://harness.gd")
+
+const TAPS := 20000
+const TAPS_PER_SECOND := 25000
+
+var h: Harness
+var input: GlobalInput
+
+
+func _initialize() -> void:
+	h = Harness.new(self)
+	run.call_deferred()
+
+
+func run() -> void:
+	var device := h.make_fifo("combo.fifo")
+	var socket := h.temp_path("stream.sock")
+
+	input = await h.start_evdev({device: "combo"}, {"event_stream_path": socket})
+	if not input:
+		return
+
+	var dropped_before := input.get_event_stream_dropped()
+	var result := await h.run_tool("gi_stream_client", ["--rate", str(TAPS_PER_SECOND), socket, device, str(TAPS)])
+	if not result.is_empty():
+		print("  %d key events in %d ms, %d per second" % [result["events"], result["elapsed_ms"], result["events_per_s"]])
+		h.check(result["missing"] == 0, "no events lost at %d edges per second" % (TAPS_PER_SECOND * 2))
+		h.check(input.get_event_stream_dropped() == dropped_before, "server dropped nothing")
+
+	dropped_before = input.get_event_stream_dropped()
+	result = await h.run_tool("gi_stream_client", ["--stall", "300", socket, device, str(TAPS)])
+	if not result.is_empty():
+		var dropped := input.get_event_stream_dropped() - dropped_before
+		print("  stalled client: %d events delivered, %d dropped" % [result["events"], dropped])
+		h.check(result["missing"] > 0, "stalled client loses events")
+		h.check(result["missing"] == dropped, "every lost event is counted")
+
+	# The game's own state never waits for the stream, every tap ended released.
+	h.check(not input.is_key_pressed(KEY_Q) and not input.is_mouse_pressed(MOUSE_BUTTON_LEFT), "hook state settled after the taps")
+
+	input.stop_hook()
+	h.finish()
@@ -0,0 +1,88 @@
+extends SceneTree
+
+# Drives the evdev backend through virtual devices only: two keyboard FIFOs and
+# a pointer FIFO written by gi_inject while the hook runs, and a recorded file
+# read to its end. Runs without access to /dev/input.
+
+const Harness = preload("res://harness.gd")
+
+# evdev codes, as gi_inject writes them.
+const EV_KEY_Y := 21
+const EV_KEY_A := 30
+const EV_KEY_LEFTSHIFT := 42
+const EV_KEY_B := 48
+const EV_BTN_LEFT := 272
+
+var h: Harness
+var input: GlobalInput
+var motion := Vector2()
+
+
+func _initialize() -> void:
+	h = Harness.new(self)
+	run.call_deferred()
+
+
+func run() -> void:
+	var keyboard := h.make_fifo("keyboard.fifo")
+	var keyboard2 := h.make_fifo("keyboard2.fifo")
+	var pointer := h.make_fifo("pointer.fifo")
+
+	input = await h.start_evdev({keyboard: "keyboard", keyboard2: "keyboard", pointer: "pointer"})
+	if not input:
+		return
+
+	var virtual_devices := input.get_devices().filter(func(device): return device.get("virtual", false))
+	h.check(virtual_devices.size() == 3, "virtual devices are listed")
+
+	await h.inject([keyboard], ["key:%d:1" % EV_KEY_A])
+	await h.frames(2)
+	h.check(input.is_key_pressed(KEY_A), "press from a FIFO")
+	h.check(input.is_physical_key_pressed(KEY_A), "physical key from a FIFO")
+
+	await h.inject([keyboard], ["key:%d:0" % EV_KEY_A])
+	await h.frames(2)
+	h.check(not input.is_key_pressed(KEY_A), "release from a FIFO")
+
+	# Steps alternate between the two keyboards.
+	await h.inject([keyboard, keyboard2], ["key:%d:1" % EV_KEY_A, "key:%d:1" % EV_KEY_B, "key:%d:1" % EV_KEY_LEFTSHIFT])
+	await h.frames(2)
+	h.check(input.is_key_pressed(KEY_A) and input.is_key_pressed(KEY_B), "keys from two devices merge")
+	h.check(input.is_shift_pressed(), "modifier from the second device")
+	await h.inject([keyboard, keyboard2], ["key:%d:0" % EV_KEY_A, "key:%d:0" % EV_KEY_B, "key:%d:0" % EV_KEY_LEFTSHIFT])
+	await h.frames(2)
+	h.check(not input.is_key_pressed(KEY_A) and not input.is_key_pressed(KEY_B) and not input.is_shift_pressed(), "releases from two devices")
+
+	# A SYN_DROPPED discards the rest of its report. Virtual devices have no
+	# state to read back, so the press is simply lost.
+	await h.inject([keyboard], ["dropped", "key:%d:1" % EV_KEY_A])
+	await h.frames(2)
+	h.check(not input.is_key_pressed(KEY_A), "report after SYN_DROPPED is dropped")
+	await h.inject([keyboard], ["key:%d:1" % EV_KEY_A, "key:%d:0" % EV_KEY_A, "taps:100:%d" % EV_KEY_B])
+	await h.frames(2)
+	h.check(not input.is_key_pressed(KEY_A) and not input.is_key_pressed(KEY_B), "reports after the dropped one apply")
+
+	# Summed every frame, including the ones that pass while gi_inject runs.
+	process_frame.connect(add_motion)
+	await h.inject([pointer], ["rel:10:5", "rel:10:5", "rel:10:5", "key:%d:1" % EV_BTN_LEFT])
+	await h.frames(4)
+	process_frame.disconnect(add_motion)
+	h.check(motion == Vector2(30, 15), "relative motion adds up (%s)" % motion)
+	h.check(input.is_mouse_pressed(MOUSE_BUTTON_LEFT), "mouse button from a FIFO")
+	await h.inject([pointer], ["key:%d:0" % EV_BTN_LEFT])
+	await h.frames(2)
+	h.check(not input.is_mouse_pressed(MOUSE_BUTTON_LEFT), "mouse button release")
+
+	# A recorded file is read once and closes at its end, its last state stays.
+	var recording := h.temp_path("recording.bin")
+	await h.inject([recording], ["key:%d:1" % EV_KEY_Y, "taps:50:%d" % EV_KEY_A], ["--record"])
+	h.check(input.add_virtual_device(recording, "keyboard", "recording"), "recorded file opens on a running hook")
+	await h.frames(4)
+	h.check(input.is_key_pressed(KEY_Y) and not input.is_key_pressed(KEY_A), "recorded file replays")
+
+	input.stop_hook()
+	h.finish()
+
+
+func add_motion() -> void:
+	motion += input.get_mouse_delta()
@@ -0,0 +1,72 @@
+extends SceneTree
+
+# XInput2 backend against the X server in $DISPLAY, normally an Xvfb started by
+# run.sh, with input synthesized by gi_xtest. Skips without a display or when
+# the extension was built without use_xinput2=yes.
+
+const Harness = preload("res://harness.gd")
+
+const EV_KEY_A := 30
+const EV_KEY_LEFTSHIFT := 42
+# Long enough for the XQueryPointer correction that follows motion.
+const SETTLE_SECONDS := 0.2
+
+var h: Harness
+var input: GlobalInput
+var motion := Vector2()
+
+
+func _initialize() -> void:
+	h = Harness.new(self)
+	run.call_deferred()
+
+
+func run() -> void:
+	if OS.get_environment("DISPLAY").is_empty():
+		print("no X display")
+		h.finish(Harness.SKIP)
+		return
+
+	input = GlobalInput.new()
+	root.add_child(input)
+	input.set_keyboard_layout("us")
+	input.backend = "xinput2"
+	input.start_hook()
+
+	if input.get_active_backend() != "xinput2":
+		print("built without use_xinput2=yes")
+		h.finish(Harness.SKIP)
+		return
+	await h.frames(2)
+	h.check(input.is_hook_ready(), "hook started on the X display")
+
+	await xtest(["move:300:200"])
+	h.check(input.get_mouse_position() == Vector2(300, 200), "absolute move corrected to the real position (%s)" % input.get_mouse_position())
+
+	process_frame.connect(add_motion)
+	await xtest(["rel:10:5"])
+	process_frame.disconnect(add_motion)
+	h.check(motion == Vector2(10, 5), "raw relative motion (%s)" % motion)
+	h.check(input.get_mouse_position() == Vector2(310, 205), "cursor follows relative motion (%s)" % input.get_mouse_position())
+
+	await xtest(["key:%d:1" % EV_KEY_A, "key:%d:1" % EV_KEY_LEFTSHIFT, "button:1:1"])
+	h.check(input.is_key_pressed(KEY_A) and input.is_physical_key_pressed(KEY_A), "raw key press")
+	h.check(input.is_shift_pressed(), "raw modifier press")
+	h.check(input.is_mouse_pressed(MOUSE_BUTTON_LEFT), "raw button press")
+
+	await xtest(["key:%d:0" % EV_KEY_A, "key:%d:0" % EV_KEY_LEFTSHIFT, "button:1:0"])
+	h.check(not input.is_key_pressed(KEY_A) and not input.is_shift_pressed(), "raw key releases")
+	h.check(not input.is_mouse_pressed(MOUSE_BUTTON_LEFT), "raw button release")
+
+	input.stop_hook()
+	h.finish()
+
+
+# Runs the steps, then lets the hook catch up while frames go on.
+func xtest(steps: Array) -> void:
+	await h.run_tool("gi_xtest", steps)
+	await create_timer(SETTLE_SECONDS).timeout
+
+
+func add_motion() -> void:
+	motion += input.get_mouse_delta()
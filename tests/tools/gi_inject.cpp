@@ -0,0 +1,239 @@
+// Writes raw input_event records into the FIFOs or recorded files GlobalInput
+// reads as virtual devices (add_virtual_device), so tests and benchmarks run
+// without access to /dev/input.
+//
+//   gi_inject [--record] [--watch PID] PATH[,PATH...] STEP...
+//
+// Every step but `dropped` and `sleep` ends with a SYN_REPORT. Steps go to the
+// paths in turn, taps and motion one tap or report at a time, so a key is
+// always pressed and released on the same device:
+//   key:CODE:VALUE       EV_KEY, VALUE 1 press, 0 release, 2 repeat
+//   rel:DX:DY            relative motion
+//   dropped              SYN_DROPPED on the next step's path, whose report ends it
+//   sleep:MSEC
+//   motion:HZ:MSEC       1 px REL_X reports at HZ for MSEC
+//   taps:COUNT:CODE,...  COUNT press and release pairs cycling through the codes
+//
+// --record creates or truncates PATH as a regular file instead of writing to a
+// FIFO. --watch prints the CPU time the hook thread (the "GlobalInput" task of
+// PID) used while the steps ran. The last line of output is
+// `reports=N elapsed_ms=T hook_cpu_ms=C` (C is -1 without --watch).
+
+#include <linux/input.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+static std::vector<int> fds;
+static size_t next_fd = 0;
+static int fd = -1;
+static bool keep_device = false;
+static uint64_t reports = 0;
+
+static uint64_t now_usec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void sleep_until(uint64_t usec) {
+    struct timespec ts;
+    ts.tv_sec = usec / 1000000;
+    ts.tv_nsec = (usec % 1000000) * 1000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+}
+
+static std::vector<std::string> split(const std::string &text, char separator) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (;;) {
+        size_t end = text.find(separator, start);
+        parts.push_back(text.substr(start, end - start));
+        if (end == std::string::npos) return parts;
+        start = end + 1;
+    }
+}
+
+// Records queue up until the report is complete, so each one goes out in a single write.
+static std::vector<struct input_event> report;
+
+static void add_event(int type, int code, int value) {
+    struct input_event ev = {};
+    uint64_t usec = now_usec();
+    ev.input_event_sec = usec / 1000000;
+    ev.input_event_usec = usec % 1000000;
+    ev.type = type;
+    ev.code = code;
+    ev.value = value;
+    report.push_back(ev);
+}
+
+static void send_report(bool syn = true) {
+    if (syn) add_event(EV_SYN, SYN_REPORT, 0);
+
+    const char *data = (const char *)report.data();
+    size_t left = report.size() * sizeof(struct input_event);
+    while (left > 0) {
+        ssize_t written = write(fd, data, left);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) {
+            fprintf(stderr, "gi_inject: write failed: %s\n", strerror(errno));
+            exit(1);
+        }
+        data += written;
+        left -= (size_t)written;
+    }
+    report.clear();
+    if (syn) reports++;
+}
+
+// Kernel ticks the named task of `pid` spent running, -1 if it has none.
+static long long task_ticks(int pid, const char *name) {
+    std::string dir = "/proc/" + std::to_string(pid) + "/task";
+    DIR *tasks = opendir(dir.c_str());
+    if (!tasks) return -1;
+
+    long long ticks = -1;
+    while (struct dirent *entry = readdir(tasks)) {
+        if (entry->d_name[0] == '.') continue;
+        std::string task = dir + "/" + entry->d_name;
+
+        char comm[32] = {};
+        FILE *file = fopen((task + "/comm").c_str(), "r");
+        if (!file) continue;
+        bool found = fgets(comm, sizeof(comm), file) && strncmp(comm, name, strlen(name)) == 0 && comm[strlen(name)] == '\n';
+        fclose(file);
+        if (!found) continue;
+
+        // utime and stime are fields 14 and 15, counted after the ")" that ends the name.
+        char stat[1024] = {};
+        file = fopen((task + "/stat").c_str(), "r");
+        if (!file) continue;
+        size_t length = fread(stat, 1, sizeof(stat) - 1, file);
+        fclose(file);
+        stat[length] = 0;
+
+        const char *fields = strrchr(stat, ')');
+        unsigned long long utime = 0, stime = 0;
+        if (fields && sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) == 2) {
+            ticks = (long long)(utime + stime);
+        }
+        break;
+    }
+    closedir(tasks);
+    return ticks;
+}
+
+// The next path in turn, or the same one again right after a `dropped`.
+static void pick_device() {
+    if (!keep_device) fd = fds[next_fd++ % fds.size()];
+    keep_device = false;
+}
+
+static bool run_step(const std::string &step) {
+    std::vector<std::string> args = split(step, ':');
+    const std::string &name = args[0];
+
+    if (name == "key" && args.size() == 3) {
+        pick_device();
+        add_event(EV_KEY, atoi(args[1].c_str()), atoi(args[2].c_str()));
+        send_report();
+    } else if (name == "rel" && args.size() == 3) {
+        pick_device();
+        add_event(EV_REL, REL_X, atoi(args[1].c_str()));
+        add_event(EV_REL, REL_Y, atoi(args[2].c_str()));
+        send_report();
+    } else if (name == "dropped" && args.size() == 1) {
+        pick_device();
+        add_event(EV_SYN, SYN_DROPPED, 0);
+        send_report(false);
+        keep_device = true;
+    } else if (name == "sleep" && args.size() == 2) {
+        sleep_until(now_usec() + (uint64_t)atoi(args[1].c_str()) * 1000);
+    } else if (name == "motion" && args.size() == 3) {
+        uint64_t period = 1000000 / (uint64_t)atoi(args[1].c_str());
+        uint64_t start = now_usec();
+        uint64_t end = start + (uint64_t)atoi(args[2].c_str()) * 1000;
+        for (uint64_t due = start; due < end; due += period) {
+            sleep_until(due);
+            pick_device();
+            add_event(EV_REL, REL_X, 1);
+            send_report();
+        }
+    } else if (name == "taps" && args.size() == 3) {
+        std::vector<std::string> codes = split(args[2], ',');
+        int count = atoi(args[1].c_str());
+        for (int i = 0; i < count; i++) {
+            int code = atoi(codes[i % codes.size()].c_str());
+            pick_device();
+            add_event(EV_KEY, code, 1);
+            send_report();
+            add_event(EV_KEY, code, 0);
+            send_report();
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    bool record = false;
+    int watch_pid = 0;
+    int arg = 1;
+    for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; arg++) {
+        if (strcmp(argv[arg], "--record") == 0) record = true;
+        else if (strcmp(argv[arg], "--watch") == 0 && arg + 1 < argc) watch_pid = atoi(argv[++arg]);
+        else {
+            fprintf(stderr, "gi_inject: unknown option %s\n", argv[arg]);
+            return 2;
+        }
+    }
+    if (arg >= argc) {
+        fprintf(stderr, "usage: gi_inject [--record] [--watch PID] PATH[,PATH...] STEP...\n");
+        return 2;
+    }
+
+    for (const std::string &path : split(argv[arg++], ',')) {
+        // Non-blocking so a FIFO nobody reads fails instead of hanging, then
+        // blocking again so a busy reader slows the writer down instead.
+        int path_fd = record ? open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+                             : open(path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        if (path_fd < 0) {
+            fprintf(stderr, "gi_inject: can't open %s: %s\n", path.c_str(), strerror(errno));
+            return 1;
+        }
+        fcntl(path_fd, F_SETFL, fcntl(path_fd, F_GETFL) & ~O_NONBLOCK);
+        fds.push_back(path_fd);
+    }
+
+    long long ticks_before = watch_pid ? task_ticks(watch_pid, "GlobalInput") : -1;
+    uint64_t start = now_usec();
+
+    for (; arg < argc; arg++) {
+        if (!run_step(argv[arg])) {
+            fprintf(stderr, "gi_inject: bad step %s\n", argv[arg]);
+            return 2;
+        }
+    }
+
+    uint64_t elapsed = now_usec() - start;
+    // Lets the hook thread finish the last reads before its time is taken.
+    if (watch_pid) sleep_until(now_usec() + 50000);
+    long long ticks_after = watch_pid ? task_ticks(watch_pid, "GlobalInput") : -1;
+    long long cpu_ms = ticks_before >= 0 && ticks_after >= 0 ? (ticks_after - ticks_before) * 1000 / sysconf(_SC_CLK_TCK) : -1;
+
+    for (int path_fd : fds) close(path_fd);
+    printf("reports=%llu elapsed_ms=%llu hook_cpu_ms=%lld\n", (unsigned long long)reports, (unsigned long long)(elapsed / 1000), cpu_ms);
+    return 0;
+}
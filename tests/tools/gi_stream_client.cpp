@@ -0,0 +1,274 @@
+// Event stream client for the tests: connects to GlobalInput's event stream
+// socket, asks for key events only, then writes key taps mixed with mouse
+// clicks into a combo virtual device FIFO and checks what comes back.
+//
+//   gi_stream_client [--rate TAPS_PER_S] [--stall MSEC] SOCKET FIFO TAPS
+//
+// Taps go out as fast as the FIFO takes them, or paced to --rate. Key edges
+// have to arrive in the order they were written, with nothing but key events
+// in the stream. Edges the server dropped for this client may be missing, but
+// never more than its frames have reported by then. --stall stops reading
+// while the FIFO is written and for MSEC after, so the server has to drop; the
+// writes still have to finish, since a slow client must never stall the hook.
+// Reading ends once the stream has been quiet for half a second after the
+// writes. On success the last line of output is
+// `events=N missing=M elapsed_ms=T events_per_s=R`, otherwise it exits with 1.
+// M should equal what get_event_stream_dropped() counted for the run.
+
+#include <linux/input.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// The wire format from src/trackers/linux/event_stream_server.h and
+// shared_state.h, spelled out the way a client outside this repo would.
+struct StreamFrame {
+    uint32_t magic;
+    uint32_t count;
+    uint64_t dropped;
+};
+
+struct StreamEvent {
+    uint64_t time_usec;
+    uint32_t type;
+    int32_t code;
+    int32_t pressed;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(StreamFrame) == 16, "frame header layout");
+static_assert(sizeof(StreamEvent) == 24, "event layout");
+
+static constexpr uint32_t STREAM_MAGIC = 0x504E4947;
+static constexpr uint32_t EVENT_KEY = 1;
+
+// evdev codes written and the Godot keys they read as on a US layout.
+static const int tap_codes[] = { KEY_Q, KEY_W, KEY_E, KEY_R };
+static const int tap_keys[] = { 81, 87, 69, 82 };
+static constexpr int TAP_CODE_COUNT = 4;
+
+struct Edge {
+    int key;
+    bool pressed;
+};
+
+static uint64_t now_usec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int fail(const char *message) {
+    fprintf(stderr, "gi_stream_client: %s\n", message);
+    return 1;
+}
+
+static void add_event(std::vector<struct input_event> &records, int type, int code, int value) {
+    struct input_event ev = {};
+    ev.type = type;
+    ev.code = code;
+    ev.value = value;
+    records.push_back(ev);
+}
+
+// Every tap is a press and a release report, every fourth one followed by a
+// click the filter has to keep out of the stream. A `rate` of 0 doesn't pace.
+static bool write_taps(int fd, int taps, int rate) {
+    std::vector<struct input_event> records;
+    uint64_t start = now_usec();
+    for (int i = 0; i < taps; i++) {
+        if (rate > 0 && i % 64 == 0) {
+            uint64_t due = start + (uint64_t)i * 1000000 / (uint64_t)rate;
+            uint64_t now = now_usec();
+            if (due > now) usleep((useconds_t)(due - now));
+        }
+
+        for (int value = 1; value >= 0; value--) {
+            add_event(records, EV_KEY, tap_codes[i % TAP_CODE_COUNT], value);
+            add_event(records, EV_SYN, SYN_REPORT, 0);
+        }
+        if (i % 4 == 3) {
+            for (int value = 1; value >= 0; value--) {
+                add_event(records, EV_KEY, BTN_LEFT, value);
+                add_event(records, EV_SYN, SYN_REPORT, 0);
+            }
+        }
+
+        if (records.size() >= 256 || i % 64 == 63 || i == taps - 1) {
+            const char *data = (const char *)records.data();
+            size_t left = records.size() * sizeof(struct input_event);
+            while (left > 0) {
+                ssize_t written = write(fd, data, left);
+                if (written < 0 && errno == EINTR) continue;
+                if (written <= 0) return false;
+                data += written;
+                left -= (size_t)written;
+            }
+            records.clear();
+        }
+    }
+    return true;
+}
+
+static bool read_exact(int fd, void *buffer, size_t size, uint64_t deadline) {
+    char *data = (char *)buffer;
+    while (size > 0) {
+        int64_t left = (int64_t)deadline - (int64_t)now_usec();
+        if (left <= 0) return false;
+
+        struct pollfd entry = { fd, POLLIN, 0 };
+        if (poll(&entry, 1, (int)(left / 1000) + 1) <= 0) continue;
+
+        ssize_t got = read(fd, data, size);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        data += got;
+        size -= (size_t)got;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int stall_msec = -1;
+    int rate = 0;
+    int arg = 1;
+    for (; arg + 1 < argc && strncmp(argv[arg], "--", 2) == 0; arg += 2) {
+        if (strcmp(argv[arg], "--stall") == 0) stall_msec = atoi(argv[arg + 1]);
+        else if (strcmp(argv[arg], "--rate") == 0) rate = atoi(argv[arg + 1]);
+        else break;
+    }
+    if (argc - arg != 3) {
+        fprintf(stderr, "usage: gi_stream_client [--rate TAPS_PER_S] [--stall MSEC] SOCKET FIFO TAPS\n");
+        return 2;
+    }
+    const char *socket_path = argv[arg];
+    const char *fifo_path = argv[arg + 1];
+    int taps = atoi(argv[arg + 2]);
+
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0 || connect(sock, (struct sockaddr *)&address, sizeof(address)) < 0) return fail("can't connect to the event stream");
+
+    uint32_t filter = 1u << EVENT_KEY;
+    if (write(sock, &filter, sizeof(filter)) != sizeof(filter)) return fail("can't send the filter");
+    // The hook thread accepts the client and reads its filter on its next pass,
+    // give it that before there are events to filter.
+    usleep(100000);
+
+    int fifo = open(fifo_path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fifo < 0) return fail("can't open the FIFO, is the hook reading it?");
+    fcntl(fifo, F_SETFL, fcntl(fifo, F_GETFL) & ~O_NONBLOCK);
+
+    std::vector<Edge> expected;
+    for (int i = 0; i < taps; i++) {
+        expected.push_back({ tap_keys[i % TAP_CODE_COUNT], true });
+        expected.push_back({ tap_keys[i % TAP_CODE_COUNT], false });
+    }
+
+    uint64_t start = now_usec();
+    std::atomic<bool> writing{true};
+    bool written = false;
+    std::thread writer([&] {
+        written = write_taps(fifo, taps, rate);
+        writing = false;
+    });
+    if (stall_msec >= 0) {
+        writer.join();
+        if (!written) return fail("writing the FIFO failed");
+        usleep((useconds_t)stall_msec * 1000);
+    }
+
+    // Matches the stream against the expected edges, skipping no more than
+    // the server says it dropped.
+    size_t next = 0;
+    uint64_t received = 0;
+    uint64_t dropped = 0;
+    uint64_t last_time = 0;
+    uint64_t last_event = start;
+    bool ok = true;
+    while (next < expected.size()) {
+        struct pollfd entry = { sock, POLLIN, 0 };
+        if (poll(&entry, 1, 500) == 0) {
+            if (!writing) break;
+            continue;
+        }
+
+        uint64_t deadline = now_usec() + 2000000;
+        StreamFrame frame;
+        if (!read_exact(sock, &frame, sizeof(frame), deadline)) {
+            fprintf(stderr, "gi_stream_client: stream ended after %llu of %zu events\n", (unsigned long long)received, expected.size());
+            ok = false;
+            break;
+        }
+        if (frame.magic != STREAM_MAGIC || frame.dropped < dropped) {
+            ok = false;
+            fprintf(stderr, "gi_stream_client: bad frame header\n");
+            break;
+        }
+        dropped = frame.dropped;
+
+        std::vector<StreamEvent> events(frame.count);
+        if (!read_exact(sock, events.data(), frame.count * sizeof(StreamEvent), deadline)) {
+            ok = false;
+            fprintf(stderr, "gi_stream_client: truncated frame\n");
+            break;
+        }
+
+        for (const StreamEvent &event : events) {
+            if (event.type != EVENT_KEY) {
+                fprintf(stderr, "gi_stream_client: event of type %u got past the filter\n", event.type);
+                ok = false;
+            }
+            if (event.time_usec < last_time) {
+                fprintf(stderr, "gi_stream_client: event times go backwards\n");
+                ok = false;
+            }
+            last_time = event.time_usec;
+
+            size_t skipped = 0;
+            while (next < expected.size() && (expected[next].key != event.code || expected[next].pressed != (event.pressed != 0))) {
+                next++;
+                skipped++;
+            }
+            if (next == expected.size() || next - received > dropped) {
+                fprintf(stderr, "gi_stream_client: event %llu (key %d %s) out of order, %zu skipped\n",
+                    (unsigned long long)received, event.code, event.pressed ? "down" : "up", skipped);
+                ok = false;
+                break;
+            }
+            next++;
+            received++;
+        }
+        if (!ok) break;
+        last_event = now_usec();
+    }
+    if (writer.joinable()) writer.join();
+    close(fifo);
+    close(sock);
+
+    if (!written) return fail("writing the FIFO failed");
+    if (!ok) return 1;
+    uint64_t missing = expected.size() - received;
+    if (stall_msec >= 0 && missing == 0) return fail("a stalled client lost nothing, backpressure never kicked in");
+
+    uint64_t elapsed = last_event - start;
+    printf("events=%llu missing=%llu elapsed_ms=%llu events_per_s=%llu\n", (unsigned long long)received,
+        (unsigned long long)missing, (unsigned long long)(elapsed / 1000),
+        (unsigned long long)(elapsed > 0 ? received * 1000000 / elapsed : 0));
+    return 0;
+}
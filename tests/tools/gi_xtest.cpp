@@ -0,0 +1,86 @@
+// Sends synthetic input to the X server in $DISPLAY through XTest, for the
+// XInput2 backend test under Xvfb.
+//
+//   gi_xtest STEP...
+//
+//   key:EVDEV_CODE:VALUE  key press (1) or release (0), by evdev code
+//   button:N:VALUE        core button N, 1 left, 3 right, 4/5 wheel
+//   move:X:Y              pointer to an absolute screen position
+//   rel:DX:DY             pointer by a relative amount
+//   sleep:MSEC
+//
+// Every step is flushed to the server before the next one. The last line of
+// output is `steps=N`; it exits with 1 if there is no display or no XTest.
+
+#include <X11/Xlib.h>
+#include <X11/extensions/XTest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+// X keycodes are evdev codes offset by 8.
+static constexpr int EVDEV_KEYCODE_OFFSET = 8;
+
+static std::vector<std::string> split(const std::string &text, char separator) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (;;) {
+        size_t end = text.find(separator, start);
+        parts.push_back(text.substr(start, end - start));
+        if (end == std::string::npos) return parts;
+        start = end + 1;
+    }
+}
+
+static bool run_step(Display *display, const std::string &step) {
+    std::vector<std::string> args = split(step, ':');
+    const std::string &name = args[0];
+
+    if (name == "key" && args.size() == 3) {
+        XTestFakeKeyEvent(display, atoi(args[1].c_str()) + EVDEV_KEYCODE_OFFSET, atoi(args[2].c_str()) != 0, CurrentTime);
+    } else if (name == "button" && args.size() == 3) {
+        XTestFakeButtonEvent(display, atoi(args[1].c_str()), atoi(args[2].c_str()) != 0, CurrentTime);
+    } else if (name == "move" && args.size() == 3) {
+        XTestFakeMotionEvent(display, DefaultScreen(display), atoi(args[1].c_str()), atoi(args[2].c_str()), CurrentTime);
+    } else if (name == "rel" && args.size() == 3) {
+        XTestFakeRelativeMotionEvent(display, atoi(args[1].c_str()), atoi(args[2].c_str()), CurrentTime);
+    } else if (name == "sleep" && args.size() == 2) {
+        usleep((useconds_t)atoi(args[1].c_str()) * 1000);
+    } else {
+        return false;
+    }
+    XSync(display, False);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Display *display = XOpenDisplay(nullptr);
+    if (!display) {
+        fprintf(stderr, "gi_xtest: can't open the display, is DISPLAY set?\n");
+        return 1;
+    }
+
+    int event_base, error_base, major, minor;
+    if (!XTestQueryExtension(display, &event_base, &error_base, &major, &minor)) {
+        fprintf(stderr, "gi_xtest: the X server has no XTest extension\n");
+        XCloseDisplay(display);
+        return 1;
+    }
+
+    for (int arg = 1; arg < argc; arg++) {
+        if (!run_step(display, argv[arg])) {
+            fprintf(stderr, "gi_xtest: bad step %s\n", argv[arg]);
+            XCloseDisplay(display);
+            return 2;
+        }
+    }
+
+    XCloseDisplay(display);
+    printf("steps=%d\n", argc - 1);
+    return 0;
+}